@@ -0,0 +1,568 @@
+/*
+ *  socket++ benchmarks
+ *
+ *  Measures latency (round trips, with percentiles) and throughput of the IO protocols
+ *   (simple_socket, text_socket, tunnel, file transfer) over the shipped transports :
+ *   socketpair, Unix sockets, loopback TCP, and loopback TCP with base_ssl.
+ *  Results are written as JSON, to be compared between versions or builds.
+ *
+ *  Usage : socketxx_bench [-t min_seconds] [-s size,size...] [-p protocol,...] [-T transport,...] [-f file_MiB] [-P tcp_port] [-S] [-o out.json]
+ *   -S enables I/O statistics on the sockets, to measure their overhead
+ */
+
+	// socket++
+#include <socket++/base_io.hpp>
+#include <socket++/base_unixsock.hpp>
+#include <socket++/base_inet.hpp>
+#ifdef XIF_USE_SSL
+#include <socket++/base_ssl.hpp>
+#endif
+#include <socket++/io/simple_socket.hpp>
+#include <socket++/io/text_buffered.hpp>
+#include <socket++/io/tunnel.hpp>
+#include <socket++/handler/socket_server.hpp>
+#include <socket++/handler/socket_client.hpp>
+
+	// OS headers
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+	// General headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <exception>
+#include <type_traits>
+
+using namespace socketxx;
+using socketxx::io::hash_t;
+
+namespace {
+
+	/************* Options and results *************/
+
+	enum transport_t { T_SOCKETPAIR, T_UNIX, T_TCP, T_TCP_SSL, T_COUNT };
+	const char* const transport_names[T_COUNT] = { "socketpair", "unix", "tcp", "tcp_ssl" };
+
+	enum protocol_t { P_SIMPLE, P_TEXT, P_TUNNEL, P_FILE, P_COUNT };
+	const char* const protocol_names[P_COUNT] = { "simple_socket", "text_socket", "tunnel", "file" };
+
+	struct options_t {
+		double min_time = 0.25;            // Minimum duration of each measure, in seconds
+		std::vector<size_t> sizes = { 16, 256, 4096, 65536 };
+		bool transports[T_COUNT] = { true, true, true, true };
+		bool protocols[P_COUNT] = { true, true, true, true };
+		size_t file_sz = 32*1024*1024;
+		in_port_t port = 47891;
+		bool io_stats = false;
+		const char* out = NULL;
+	} opt;
+
+	const uint64_t warmup_iter = 16;       // Round trips not recorded
+	const uint64_t min_iter = 32;
+	const uint64_t max_iter = 2000000;
+
+	struct result {
+		protocol_t protocol;
+		transport_t transport;
+		const char* test;                  // "latency" or "throughput"
+		const char* hash;                  // File transfer only
+		size_t msg_sz;
+		uint64_t n;                        // Messages or round trips
+		double secs;
+		std::vector<double> lat;           // Round trip durations, in µs
+	};
+	std::vector<result> results;
+
+	inline double now () {
+		timespec ts;
+		::clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + ts.tv_nsec*1e-9;
+	}
+
+		/// Peer thread. Exceptions are rethrown by join(). If destructed while running (error on the measuring side), its socket is shut down to unblock it
+	class peer {
+		std::exception_ptr e;
+		socket_t fd;
+		std::thread t;
+	public:
+		template <typename F> peer (socket_t fd, F f) : e(), fd(fd), t([this,f]() { try { f(); } catch (...) { e = std::current_exception(); } }) {}
+		void join () { t.join(); if (e) std::rethrow_exception(e); }
+		~peer () { if (t.joinable()) { ::shutdown(fd, SHUT_RDWR); t.join(); } }
+	};
+
+	/************* Transports *************/
+
+		// Connected pair of sockets. Setup is not measured, only the fds are kept (sockets are preserved from shutdown()).
+	struct fd_pair {
+		socket_t a, b;
+		fd_pair (base_fd a, base_fd b) : a(::dup(a.get_fd())), b(::dup(b.get_fd())) { a.set_preserved(); b.set_preserved(); }
+	};
+
+	std::string unix_path () {
+		const char* tmp = ::getenv("TMPDIR");
+		return std::string(tmp ? tmp : "/tmp") + "/socketxx_bench." + std::to_string(::getpid()) + ".sock";
+	}
+
+	fd_pair connect_pair (transport_t t) {
+		if (t == T_SOCKETPAIR) {
+			std::pair<base_unixsock,base_unixsock> p = base_unixsock::create_socket_pair();
+			return fd_pair(p.first, p.second);
+		}
+		if (t == T_UNIX) {
+			std::string path = unix_path();
+			::unlink(path.c_str());
+			end::socket_server<base_unixsock,void> srv (base_unixsock::addr_info(path.c_str()), 1);
+			end::socket_client<base_unixsock> cli (base_unixsock::addr_info(path.c_str()));
+			return fd_pair(cli, srv.wait_new_client());
+		}
+		in_addr lo; lo.s_addr = htonl(INADDR_LOOPBACK);
+		end::socket_server<base_netsock,void> srv (base_netsock::addr_info(lo, opt.port), 1, true);
+		end::socket_client<base_netsock> cli (base_netsock::addr_info(lo, opt.port));
+		fd_pair p (cli, srv.wait_new_client());
+			// Request/response latency is what is measured : Nagle's algorithm would only add delayed-ACK stalls
+		int one = 1;
+		::setsockopt(p.a, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		::setsockopt(p.b, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		return p;
+	}
+
+		// Any BaseIO or IO protocol, adopting a connected socket
+	template <typename sock_t>
+	struct adopted : public sock_t {
+		adopted (socket_t fd) : sock_t(true, fd) { if (opt.io_stats) this->enable_stats(); }
+	};
+
+#ifdef XIF_USE_SSL
+		// Self-signed certificate for the server side
+	EVP_PKEY* ssl_key = NULL;
+	X509* ssl_cert = NULL;
+
+	void ssl_make_cert () {
+		EVP_PKEY_CTX* kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+		if (kctx == NULL or EVP_PKEY_keygen_init(kctx) <= 0 or EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kctx, NID_X9_62_prime256v1) <= 0 or EVP_PKEY_keygen(kctx, &ssl_key) <= 0)
+			throw socketxx::ssl_error(ssl_error::START);
+		EVP_PKEY_CTX_free(kctx);
+		ssl_cert = X509_new();
+		X509_set_version(ssl_cert, 2);
+		ASN1_INTEGER_set(X509_get_serialNumber(ssl_cert), 1);
+		X509_gmtime_adj(X509_get_notBefore(ssl_cert), 0);
+		X509_gmtime_adj(X509_get_notAfter(ssl_cert), 24*3600);
+		X509_set_pubkey(ssl_cert, ssl_key);
+		X509_NAME* name = X509_get_subject_name(ssl_cert);
+		X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+		X509_set_issuer_name(ssl_cert, name);
+		if (X509_sign(ssl_cert, ssl_key, EVP_sha256()) == 0)
+			throw socketxx::ssl_error(ssl_error::START);
+	}
+
+	void ssl_ctx_setup (SSL_CTX* ctx, bool server_side) {
+		if (server_side) {
+			if (SSL_CTX_use_certificate(ctx, ssl_cert) != 1 or SSL_CTX_use_PrivateKey(ctx, ssl_key) != 1)
+				throw socketxx::ssl_error(ssl_error::START);
+		}
+	}
+
+		// TLS handshake, for sockets built on base_ssl
+	template <typename A, typename B>
+	void start_session (A& a, B& b, std::true_type) {
+		peer p (b.get_fd(), [&b]() { b.wait_for_ssl(); });
+		a.start_ssl();
+		p.join();
+	}
+#endif
+	template <typename A, typename B>
+	void start_session (A&, B&, std::false_type) {}
+
+	template <typename A, typename B>
+	void start_session (A& a, B& b) {
+#ifdef XIF_USE_SSL
+		start_session(a, b, std::integral_constant<bool, std::is_base_of<base_ssl,A>::value>());
+#else
+		start_session(a, b, std::false_type());
+#endif
+	}
+
+		// Calls `bench.run<BaseIO>(fds, transport)` with the BaseIO of the transport
+	template <typename bench_t>
+	void run_on (bench_t& bench, transport_t t) {
+		fd_pair p = connect_pair(t);
+		switch (t) {
+			case T_SOCKETPAIR: case T_UNIX: bench.template run<base_unixsock>(p, t); break;
+			case T_TCP: bench.template run<base_netsock>(p, t); break;
+#ifdef XIF_USE_SSL
+			case T_TCP_SSL: bench.template run<base_ssl>(p, t); break;
+#endif
+			default: ::close(p.a); ::close(p.b);
+		}
+	}
+
+	/************* Measures *************/
+
+		// Calls `round_trip` until the minimum time is elapsed, recording the duration of each one
+	template <typename F>
+	void measure_latency (result& r, F round_trip) {
+		for (uint64_t i = 0; i < warmup_iter; i++)
+			round_trip();
+		r.lat.reserve(1024);
+		double beg = now(), t = beg;
+		do {
+			double t0 = t;
+			round_trip();
+			t = now();
+			r.lat.push_back((t - t0) * 1e6);
+		} while ((t - beg < opt.min_time or r.lat.size() < min_iter) and r.lat.size() < max_iter);
+		r.n = r.lat.size();
+		r.secs = t - beg;
+	}
+
+		// Calls `send` until the minimum time is elapsed, then `end` which must wait for the receiver to acknowledge all messages
+	template <typename F, typename E>
+	void measure_throughput (result& r, F send, E end, uint64_t min_n = min_iter) {
+		double beg = now();
+		uint64_t n = 0;
+		do {
+			send();
+			n++;
+		} while ((now() - beg < opt.min_time or n < min_n) and n < max_iter);
+		uint64_t recvd = end();
+		r.secs = now() - beg;
+		r.n = n;
+		if (recvd != n)
+			throw socketxx::error("benchmark : receiver counted a different number of messages");
+	}
+
+	result new_result (protocol_t p, transport_t t, const char* test, size_t sz) {
+		result r;
+		r.protocol = p; r.transport = t; r.test = test; r.hash = NULL;
+		r.msg_sz = sz; r.n = 0; r.secs = 0;
+		return r;
+	}
+
+	/************* Protocols *************/
+
+		/// simple_socket : binary messages (o_bin/i_bin). An empty message ends the peer's loop.
+
+	template <typename S>
+	void simple_echo (S& s) {
+		for (;;) {
+			auto_bdata m = s.i_bin();
+			if (m.len == 0) break;
+			s.o_bin(m.p, m.len);
+		}
+	}
+	template <typename S>
+	void simple_sink (S& s) {
+		uint64_t n = 0;
+		for (;;) {
+			auto_bdata m = s.i_bin();
+			if (m.len == 0) break;
+			n++;
+		}
+		s.template o_int<uint64_t>(n);
+	}
+
+		// Latency and throughput tests with a peer socket `b`, echoing or counting
+	template <typename A, typename B>
+	void simple_tests (A& a, B& b, socket_t b_fd, protocol_t proto, transport_t t, size_t sz) {
+		std::vector<char> buf (sz, 'x');
+		{
+			result r = new_result(proto, t, "latency", sz);
+			peer p (b_fd, [&b]() { simple_echo(b); });
+			measure_latency(r, [&]() { a.o_bin(buf.data(), sz); auto_bdata m = a.i_bin(); });
+			a.o_bin(NULL, 0);
+			p.join();
+			results.push_back(r);
+		}
+		{
+			result r = new_result(proto, t, "throughput", sz);
+			peer p (b_fd, [&b]() { simple_sink(b); });
+			measure_throughput(r, [&]() { a.o_bin(buf.data(), sz); }, [&]() -> uint64_t { a.o_bin(NULL, 0); return a.template i_int<uint64_t>(); });
+			p.join();
+			results.push_back(r);
+		}
+	}
+
+	struct bench_simple {
+		size_t sz;
+		template <typename io_base>
+		void run (fd_pair p, transport_t t) {
+			adopted< io::simple_socket<io_base> > a (p.a), b (p.b);
+			start_session(a, b);
+			simple_tests(a, b, p.b, P_SIMPLE, t, sz);
+		}
+	};
+
+		/// text_socket : lines of `sz` chars. An empty line ends the peer's loop.
+
+	struct bench_text {
+		size_t sz;
+		template <typename io_base>
+		void run (fd_pair p, transport_t t) {
+			adopted< io::text_socket<io_base> > a (p.a), b (p.b);
+			start_session(a, b);
+			std::string line (sz, 'x');
+			{
+				result r = new_result(P_TEXT, t, "latency", sz);
+				peer pr (p.b, [&b]() { for (;;) { std::string l = b.i_line(); if (l.empty()) break; b.o_line(l); } });
+				measure_latency(r, [&]() { a.o_line(line); a.i_line(); });
+				a.o_line("");
+				pr.join();
+				results.push_back(r);
+			}
+			{
+				result r = new_result(P_TEXT, t, "throughput", sz);
+				peer pr (p.b, [&b]() { uint64_t n = 0; while (not b.i_line().empty()) n++; b.o_line(std::to_string(n)); });
+				measure_throughput(r, [&]() { a.o_line(line); }, [&]() -> uint64_t { a.o_line(""); return ::strtoull(a.i_line().c_str(), NULL, 10); });
+				pr.join();
+				results.push_back(r);
+			}
+		}
+	};
+
+		/// tunnel : simple_socket messages going through a tunnel between the transport and a socketpair
+		///  a ==transport== b [tunnel] c --socketpair-- d
+
+	struct bench_tunnel {
+		size_t sz;
+		template <typename io_base>
+		void run (fd_pair p, transport_t t) {
+			adopted< io::simple_socket<io_base> > a (p.a);
+			adopted<io_base> b (p.b);
+			start_session(a, b);
+			std::pair<base_unixsock,base_unixsock> cd = base_unixsock::create_socket_pair();
+			io::tunnel<base_unixsock,io_base> c (cd.first);
+			io::simple_socket<base_unixsock> d (cd.second);
+				// Ends when `a` is shut down
+			peer tun (p.b, [&b,&c]() { c.start_tunneling(b); });
+			simple_tests(a, d, d.get_fd(), P_TUNNEL, t, sz);
+			::shutdown(p.a, SHUT_RDWR);
+			tun.join();
+		}
+	};
+
+		/// File transfer : o_file/i_file of a file of `opt.file_sz` bytes, acknowledged by the receiver
+
+	struct bench_file {
+		hash_t hash;
+		const char* hash_name;
+		std::string src;
+		template <typename io_base>
+		void run (fd_pair p, transport_t t) {
+			adopted< io::simple_socket<io_base> > a (p.a), b (p.b);
+			start_session(a, b);
+			std::string dst_path = src + ".dst";
+			fd_t dst = ::open(dst_path.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0600);
+			if (dst == -1)
+				throw socketxx::other_error("benchmark : can't create file");
+			::unlink(dst_path.c_str());
+			result r = new_result(P_FILE, t, "throughput", opt.file_sz);
+			r.hash = hash_name;
+			hash_t h = hash;
+			peer pr (p.b, [&b,dst,h]() {
+				uint64_t n = 0;
+				while (b.i_bool()) {
+					if (::ftruncate(dst, 0) == -1 or ::lseek(dst, 0, SEEK_SET) == -1)
+						throw socketxx::other_error("benchmark : can't truncate file");
+					b.i_file(dst, NULL, h);
+					n++;
+				}
+				b.template o_int<uint64_t>(n);
+			});
+			try {
+				measure_throughput(r, [&]() { a.o_bool(true); a.o_file(src.c_str(), NULL, h); }, [&]() -> uint64_t { a.o_bool(false); return a.template i_int<uint64_t>(); }, 1);
+				pr.join();
+			} catch (...) {
+				::close(dst); throw;
+			}
+			::close(dst);
+			results.push_back(r);
+		}
+	};
+
+	std::string make_src_file () {
+		const char* tmp = ::getenv("TMPDIR");
+		std::string path = std::string(tmp ? tmp : "/tmp") + "/socketxx_bench." + std::to_string(::getpid()) + ".src";
+		fd_t fd = ::open(path.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0600);
+		if (fd == -1)
+			throw socketxx::other_error("benchmark : can't create file");
+			// Incompressible content
+		std::vector<uint32_t> blk (64*1024/sizeof(uint32_t));
+		uint32_t x = 2463534242u;
+		for (size_t done = 0; done < opt.file_sz; ) {
+			for (uint32_t& w : blk) { x ^= x << 13; x ^= x >> 17; x ^= x << 5; w = x; }
+			size_t len = std::min(opt.file_sz - done, blk.size()*sizeof(uint32_t));
+			if (::write(fd, blk.data(), len) != (ssize_t)len) {
+				::close(fd); ::unlink(path.c_str()); throw socketxx::other_error("benchmark : can't write file");
+			}
+			done += len;
+		}
+		::close(fd);
+		return path;
+	}
+
+	/************* Output *************/
+
+	double percentile (const std::vector<double>& sorted, double p) {
+		size_t i = (size_t)(p * (sorted.size()-1) + 0.5);
+		return sorted[i];
+	}
+
+	void write_json (FILE* f) {
+		fprintf(f, "{\n");
+		fprintf(f, "  \"library\": \"socket++\",\n");
+#ifdef PACKAGE_VERSION
+		fprintf(f, "  \"version\": \"%s\",\n", PACKAGE_VERSION);
+#endif
+#ifdef XIF_USE_SSL
+		fprintf(f, "  \"openssl\": \"%s\",\n", OPENSSL_VERSION_TEXT);
+#endif
+		char host[256] = "";
+		::gethostname(host, sizeof(host)-1);
+		fprintf(f, "  \"host\": \"%s\",\n", host);
+		fprintf(f, "  \"timestamp\": %ld,\n", (long)::time(NULL));
+		fprintf(f, "  \"min_time\": %g,\n", opt.min_time);
+		fprintf(f, "  \"tcp_nodelay\": true,\n");
+		fprintf(f, "  \"io_stats\": %s,\n", opt.io_stats ? "true" : "false");
+		fprintf(f, "  \"results\": [");
+		for (size_t k = 0; k < results.size(); k++) {
+			result& r = results[k];
+			fprintf(f, "%s\n    { \"protocol\": \"%s\", \"transport\": \"%s\", \"test\": \"%s\", ", (k == 0) ? "" : ",", protocol_names[r.protocol], transport_names[r.transport], r.test);
+			if (r.hash != NULL)
+				fprintf(f, "\"hash\": \"%s\", ", r.hash);
+			fprintf(f, "\"msg_size\": %zu, \"count\": %llu, \"seconds\": %.6f, \"msg_per_s\": %.1f, \"mib_per_s\": %.3f",
+			        r.msg_sz, (unsigned long long)r.n, r.secs, r.n / r.secs, (double)r.msg_sz * r.n / r.secs / (1024*1024));
+			if (not r.lat.empty()) {
+				std::vector<double> s = r.lat;
+				std::sort(s.begin(), s.end());
+				double sum = 0;
+				for (double v : s) sum += v;
+				fprintf(f, ", \"latency_us\": { \"mean\": %.3f, \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f }",
+				        sum / s.size(), s.front(), percentile(s, 0.5), percentile(s, 0.9), percentile(s, 0.99), percentile(s, 0.999), s.back());
+			}
+			fprintf(f, " }");
+		}
+		fprintf(f, "\n  ]\n}\n");
+	}
+
+	/************* Command line *************/
+
+		// Comma-separated list of names, setting the matching flags
+	template <size_t N>
+	void parse_names (const char* arg, const char* const (&names)[N], bool (&flags)[N]) {
+		for (size_t i = 0; i < N; i++) flags[i] = false;
+		std::string s (arg);
+		size_t beg = 0;
+		while (beg <= s.size()) {
+			size_t end = s.find(',', beg);
+			if (end == std::string::npos) end = s.size();
+			std::string name = s.substr(beg, end-beg);
+			size_t i;
+			for (i = 0; i < N; i++)
+				if (name == names[i]) { flags[i] = true; break; }
+			if (i == N) {
+				fprintf(stderr, "unknown name '%s'\n", name.c_str());
+				::exit(2);
+			}
+			beg = end+1;
+		}
+	}
+
+	void usage (const char* prog) {
+		fprintf(stderr, "Usage : %s [-t min_seconds] [-s size,size...] [-p protocol,...] [-T transport,...] [-f file_MiB] [-P tcp_port] [-S] [-o out.json]\n", prog);
+		fprintf(stderr, "  protocols : simple_socket text_socket tunnel file\n  transports : socketpair unix tcp tcp_ssl\n");
+		::exit(2);
+	}
+
+}
+
+int main (int argc, char* const argv[]) {
+	int c;
+	while ((c = ::getopt(argc, argv, "t:s:p:T:f:P:So:h")) != -1) {
+		switch (c) {
+			case 't': opt.min_time = ::atof(optarg); break;
+			case 's': {
+				opt.sizes.clear();
+				for (char* p = optarg; *p != '\0'; ) {
+					size_t sz = ::strtoul(p, &p, 10);
+					if (sz == 0) usage(argv[0]);
+					opt.sizes.push_back(sz);
+					if (*p == ',') p++;
+				}
+			} break;
+			case 'p': parse_names(optarg, protocol_names, opt.protocols); break;
+			case 'T': parse_names(optarg, transport_names, opt.transports); break;
+			case 'f': opt.file_sz = (size_t)::atof(optarg) * 1024*1024; break;
+			case 'P': opt.port = (in_port_t)::atoi(optarg); break;
+			case 'S': opt.io_stats = true; break;
+			case 'o': opt.out = optarg; break;
+			default: usage(argv[0]);
+		}
+	}
+	::signal(SIGPIPE, SIG_IGN);
+#ifdef XIF_USE_SSL
+	if (opt.transports[T_TCP_SSL]) {
+		ssl_make_cert();
+		base_ssl::set_ctx_setup(ssl_ctx_setup);
+	}
+#else
+	if (opt.transports[T_TCP_SSL]) {
+		fprintf(stderr, "tcp_ssl : socket++ built without OpenSSL, skipped\n");
+		opt.transports[T_TCP_SSL] = false;
+	}
+#endif
+
+	try {
+		for (int t = 0; t < T_COUNT; t++) {
+			if (not opt.transports[t]) continue;
+			for (size_t sz : opt.sizes) {
+				if (opt.protocols[P_SIMPLE]) { fprintf(stderr, "simple_socket %s %zu\n", transport_names[t], sz); bench_simple b = { sz }; run_on(b, (transport_t)t); }
+				if (opt.protocols[P_TEXT])   { fprintf(stderr, "text_socket %s %zu\n", transport_names[t], sz);   bench_text b = { sz };   run_on(b, (transport_t)t); }
+				if (opt.protocols[P_TUNNEL]) { fprintf(stderr, "tunnel %s %zu\n", transport_names[t], sz);        bench_tunnel b = { sz }; run_on(b, (transport_t)t); }
+			}
+		}
+		if (opt.protocols[P_FILE]) {
+			std::string src = make_src_file();
+			struct { hash_t h; const char* name; } hashes[] = {
+				{ io::HASH_NONE, "none" }, { io::HASH_CRC32C, "crc32c" }, { io::HASH_XXH64, "xxh64" },
+#ifdef XIF_USE_SSL
+				{ io::HASH_MD5, "md5" },
+#endif
+			};
+			try {
+				for (int t = 0; t < T_COUNT; t++) {
+					if (not opt.transports[t]) continue;
+					for (auto& h : hashes) {
+						fprintf(stderr, "file %s %s\n", transport_names[t], h.name);
+						bench_file b = { h.h, h.name, src };
+						run_on(b, (transport_t)t);
+					}
+				}
+			} catch (...) {
+				::unlink(src.c_str()); throw;
+			}
+			::unlink(src.c_str());
+		}
+	} catch (std::exception& e) {
+		fprintf(stderr, "benchmark failed : %s\n", e.what());
+		return 1;
+	}
+
+	FILE* f = stdout;
+	if (opt.out != NULL) {
+		f = ::fopen(opt.out, "w");
+		if (f == NULL) { ::perror(opt.out); return 1; }
+	}
+	write_json(f);
+	if (f != stdout) ::fclose(f);
+	return 0;
+}
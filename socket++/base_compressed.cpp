@@ -0,0 +1,193 @@
+#include <socket++/base_compressed.hpp>
+
+	// General headers
+#include <string.h>
+
+#ifdef XIF_USE_ZLIB
+
+namespace socketxx { namespace _base_compressed {
+
+	/************* BaseCompressed Implementation *************/
+
+	const size_t compress_min = 64;             // Smaller frames are always stored
+	const size_t bypass_win_min = 256*1024;     // First bypass window, doubled each time data is still incompressible
+	const size_t bypass_win_max = 16*1024*1024;
+	const size_t frame_max_wire = 1024*1024;    // Sanity limit for received frames
+
+	codec::codec (int level, bool per_message) : raw_out(0), wire_out(0), per_message(per_message), cbuf(NULL), wbuf(NULL), wbuf_len(0), wcoalesce(false), bypass_rest(0), bypass_win(bypass_win_min), ibuf(NULL), ibuf_sz(0), obuf(NULL), obuf_beg(0), obuf_end(0), inflate_more(false), stored_rest(0) {
+		::memset(&zo, 0, sizeof(z_stream));
+		::memset(&zi, 0, sizeof(z_stream));
+		if (::deflateInit(&zo, level) != Z_OK)
+			throw socketxx::error("compressed socket : deflateInit() failed");
+		if (::inflateInit(&zi) != Z_OK) {
+			::deflateEnd(&zo);
+			throw socketxx::error("compressed socket : inflateInit() failed");
+		}
+		cbuf_sz = frame_hdr_sz + ::deflateBound(&zo, frame_max_raw) + 16; // Sync flush marker
+		cbuf = new uint8_t[cbuf_sz];
+	}
+
+	codec::~codec () {
+		::deflateEnd(&zo);
+		::inflateEnd(&zi);
+		delete[] cbuf;
+		delete[] wbuf;
+		delete[] ibuf;
+		delete[] obuf;
+	}
+
+		/// Output
+
+	void codec::write (base_fd& s, base_fd::_io_fncts::o_fnct o, const void* d, size_t len) {
+		if (not wcoalesce) {
+			this->send_frames(s, o, (const uint8_t*)d, len);
+			return;
+		}
+		if (wbuf == NULL)
+			wbuf = new uint8_t[frame_max_raw];
+		if (wbuf_len + len > frame_max_raw)
+			this->flush(s, o);
+		if (len >= frame_max_raw) {
+			this->send_frames(s, o, (const uint8_t*)d, len);
+			return;
+		}
+		::memcpy(wbuf + wbuf_len, d, len);
+		wbuf_len += len;
+	}
+
+	void codec::flush (base_fd& s, base_fd::_io_fncts::o_fnct o) {
+		if (wbuf_len == 0) return;
+		size_t len = wbuf_len;
+		wbuf_len = 0;
+		this->send_frames(s, o, wbuf, len);
+	}
+
+	void codec::send_frames (base_fd& s, base_fd::_io_fncts::o_fnct o, const uint8_t* d, size_t len) {
+		while (len != 0) {
+			size_t rawsz = (len < frame_max_raw) ? len : frame_max_raw;
+			uint8_t flags = 0;
+			size_t paysz;
+			if (rawsz < compress_min or bypass_rest != 0) {
+					// Stored
+				::memcpy(cbuf + frame_hdr_sz, d, rawsz);
+				paysz = rawsz;
+				bypass_rest = (bypass_rest > rawsz) ? bypass_rest - rawsz : 0;
+			} else {
+					// Deflated
+				flags = FRAME_DEFLATE;
+				if (per_message) {
+					::deflateReset(&zo);
+					flags |= FRAME_RESET;
+				}
+				zo.next_in = (Bytef*)d;
+				zo.avail_in = (uInt)rawsz;
+				zo.next_out = cbuf + frame_hdr_sz;
+				zo.avail_out = (uInt)(cbuf_sz - frame_hdr_sz);
+				int r = ::deflate(&zo, Z_SYNC_FLUSH);
+				if (r != Z_OK or zo.avail_in != 0)
+					throw socketxx::error("compressed socket : deflate() failed");
+				paysz = (cbuf_sz - frame_hdr_sz) - zo.avail_out;
+					// Incompressible : the frame is sent (the context already has it), but following data will be stored
+				if (paysz*10 > rawsz*9) {
+					bypass_rest = bypass_win;
+					if (bypass_win < bypass_win_max) bypass_win *= 2;
+				} else
+					bypass_win = bypass_win_min;
+			}
+			cbuf[0] = flags;
+			for (uint8_t i = 0; i < 4; i++)
+				cbuf[1+i] = (uint8_t)(paysz >> (8*i));
+			(s.*o)(cbuf, frame_hdr_sz + paysz);
+			raw_out += rawsz;
+			wire_out += frame_hdr_sz + paysz;
+			d += rawsz;
+			len -= rawsz;
+		}
+	}
+
+		/// Input
+
+	void codec::read_frame (base_fd& s, base_fd::_io_fncts::i_fnct i) {
+		uint8_t hdr[frame_hdr_sz];
+		codec::read_raw(s, i, hdr, frame_hdr_sz);
+		size_t paysz = 0;
+		for (uint8_t k = 0; k < 4; k++)
+			paysz |= (size_t)hdr[1+k] << (8*k);
+		if (not (hdr[0] & FRAME_DEFLATE)) {
+			stored_rest = paysz;
+			return;
+		}
+		if (paysz > frame_max_wire)
+			throw socketxx::error("compressed socket : corrupted frame");
+		if (paysz > ibuf_sz) {
+			delete[] ibuf;
+			ibuf = NULL;
+			ibuf = new uint8_t[paysz];
+			ibuf_sz = paysz;
+		}
+		codec::read_raw(s, i, ibuf, paysz);
+		if (hdr[0] & FRAME_RESET)
+			::inflateReset(&zi);
+		zi.next_in = ibuf;
+		zi.avail_in = (uInt)paysz;
+		inflate_more = true;
+	}
+
+	void codec::inflate_obuf () {
+		if (obuf == NULL)
+			obuf = new uint8_t[frame_max_raw];
+		zi.next_out = obuf;
+		zi.avail_out = (uInt)frame_max_raw;
+		int r = ::inflate(&zi, Z_SYNC_FLUSH);
+		if (r != Z_OK and r != Z_BUF_ERROR)
+			throw socketxx::error("compressed socket : corrupted data");
+		obuf_beg = 0;
+		obuf_end = frame_max_raw - zi.avail_out;
+		if (r == Z_BUF_ERROR and obuf_end == 0 and zi.avail_in != 0)
+			throw socketxx::error("compressed socket : corrupted data");
+		inflate_more = (zi.avail_in != 0 or zi.avail_out == 0); // zlib may hold more output if the buffer was filled
+	}
+
+	size_t codec::read (base_fd& s, base_fd::_io_fncts::i_fnct i, void* d, size_t maxlen) {
+		for (;;) {
+			if (obuf_end != obuf_beg) {
+				size_t len = obuf_end - obuf_beg;
+				if (len > maxlen) len = maxlen;
+				::memcpy(d, obuf + obuf_beg, len);
+				obuf_beg += len;
+				return len;
+			}
+			if (inflate_more) {
+				this->inflate_obuf();
+				continue;
+			}
+			if (stored_rest != 0) {
+				size_t len = (s.*i)(d, (maxlen < stored_rest) ? maxlen : stored_rest);
+				stored_rest -= len;
+				return len;
+			}
+			this->read_frame(s, i);
+		}
+	}
+
+	void codec::read_fixsize (base_fd& s, base_fd::_io_fncts::i_fnct i, void* d, size_t len) {
+		uint8_t* p = (uint8_t*)d;
+		while (len != 0) {
+			size_t r = this->read(s, i, p, len);
+			p += r;
+			len -= r;
+		}
+	}
+
+	void codec::read_raw (base_fd& s, base_fd::_io_fncts::i_fnct i, void* d, size_t len) {
+		uint8_t* p = (uint8_t*)d;
+		while (len != 0) {
+			size_t r = (s.*i)(p, len);
+			p += r;
+			len -= r;
+		}
+	}
+
+}}
+
+#endif
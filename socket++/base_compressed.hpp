@@ -0,0 +1,134 @@
+#ifndef SOCKET_XX_BASE_COMPRESSED_H
+#define SOCKET_XX_BASE_COMPRESSED_H
+
+	// BaseIO
+#include <socket++/base_io.hpp>
+
+#ifdef XIF_USE_ZLIB
+
+	// zlib
+#include <zlib.h>
+
+namespace socketxx {
+
+		// Private external functions
+	namespace _base_compressed {
+
+			// Frame : [flags u8][payload length u32, little-endian][payload]
+		const uint8_t FRAME_DEFLATE = 0x1; // Payload is deflated, stored otherwise
+		const uint8_t FRAME_RESET = 0x2;   // Compression context was reset before this frame
+		const size_t frame_hdr_sz = 5;
+		const size_t frame_max_raw = 64*1024;
+
+			// Compression/decompression state, shared by copies of the BaseIO
+		class codec {
+		public:
+			codec (int level, bool per_message);
+			~codec ();
+			codec (const codec&) = delete;
+
+				// Output
+			void write (base_fd& s, base_fd::_io_fncts::o_fnct o, const void* d, size_t len);
+			void flush (base_fd& s, base_fd::_io_fncts::o_fnct o);
+			void set_write_coalescing (bool enable) { wcoalesce = enable; }
+				// Input
+			size_t read (base_fd& s, base_fd::_io_fncts::i_fnct i, void* d, size_t maxlen);
+			void read_fixsize (base_fd& s, base_fd::_io_fncts::i_fnct i, void* d, size_t len);
+			size_t buffered () const { return (obuf_end - obuf_beg) + (inflate_more ? 1 : 0); }
+
+				// Statistics of sent data
+			uint64_t raw_out, wire_out;
+
+		private:
+			bool per_message;
+				// Output
+			z_stream zo;
+			uint8_t* cbuf; size_t cbuf_sz;  // Frame being built
+			uint8_t* wbuf; size_t wbuf_len; // Write-combining buffer
+			bool wcoalesce;
+			size_t bypass_rest, bypass_win; // Adaptive bypass : bytes to send stored, and next bypass window
+			void send_frames (base_fd& s, base_fd::_io_fncts::o_fnct o, const uint8_t* d, size_t len);
+				// Input
+			z_stream zi;
+			uint8_t* ibuf; size_t ibuf_sz;  // Compressed frame payload
+			uint8_t* obuf; size_t obuf_beg, obuf_end;
+			bool inflate_more;
+			size_t stored_rest;             // Remaining bytes of current stored frame, read directly from the socket
+			static void read_raw (base_fd& s, base_fd::_io_fncts::i_fnct i, void* d, size_t len);
+			void read_frame (base_fd& s, base_fd::_io_fncts::i_fnct i);
+			void inflate_obuf ();
+		};
+
+		struct codec_ref : public refcountxx_base {
+			codec* c;
+			codec_ref (codec* c) : c(c) {}
+			codec_ref (const codec_ref& o) : refcountxx_base(o), c(o.c) {}
+			~codec_ref () { if (this->can_destruct()) delete c; }
+			codec* operator-> () const { return c; }
+		};
+
+	}
+
+		///------ Base class for compressed streams ------///
+	/*
+	 *  Transport filter compressing data with zlib, on top of any BaseIO (base_socket, base_ssl, base_pipe...).
+	 *  Data is sent in frames of max 64KiB of raw data, deflated or stored.
+	 *  In stream mode (default), the compression context is kept across frames : small repetitive
+	 *   messages compress well. In per-message mode, each frame can be decompressed on its own.
+	 *  Incompressible data (ratio worse than 90%) triggers a bypass : following data is stored without
+	 *   trying to compress it, on a window growing while data stays incompressible.
+	 *  Both sides must use base_compressed, with any level and mode. Copies share the compression state.
+	 *  Write coalescing can be enabled to group small writes into bigger frames, as base_ssl.
+	 */
+	template <typename io_base>
+	class base_compressed : public io_base {
+	protected:
+
+			// Compression state
+		_base_compressed::codec_ref c;
+
+			// I/O functions of the underlying BaseIO (non-virtual call)
+		base_fd::_io_fncts _raw_fncts () { return this->io_base::_get_io_fncts(); }
+
+			// Private initialization
+		base_compressed (bool autoclose_handle, socket_t handle) : io_base(autoclose_handle, handle), c(new _base_compressed::codec(Z_DEFAULT_COMPRESSION, false)) {}
+		base_compressed () : io_base(), c(new _base_compressed::codec(Z_DEFAULT_COMPRESSION, false)) {}
+
+	public:
+
+			// Construct from an io_base object. `level` is zlib's compression level (1-9)
+		base_compressed (const io_base& o, int level = Z_DEFAULT_COMPRESSION, bool per_message = false) : io_base(o), c(new _base_compressed::codec(level, per_message)) {}
+			// Copy constructor : compression state is shared
+		base_compressed (const base_compressed& o) : io_base(o), c(o.c) {}
+		base_compressed (base_compressed&& o) noexcept : io_base(std::move(o)), c(o.c) {}
+		base_compressed& operator= (const base_compressed&) = delete;
+
+			// Write coalescing : pending data is sent when the buffer is full, before any read, and on flush().
+			//  It must be flushed before the socket is destroyed.
+		void set_write_coalescing (bool enable) { if (not enable) this->flush(); c->set_write_coalescing(enable); }
+		void flush () { c->flush(*this, _raw_fncts().o); }
+
+			// Statistics of sent data : raw bytes given, and bytes sent on the underlying BaseIO
+		void compression_stats (uint64_t& raw, uint64_t& wire) const { raw = c->raw_out; wire = c->wire_out; }
+
+			// Decompressed data waiting in buffers
+		virtual size_t i_buffered () const { return io_base::i_buffered() + c->buffered(); }
+
+		// Common I/O routines
+	protected:
+			// Send
+		void _o (const void* d, size_t len) { c->write(*this, _raw_fncts().o, d, len); }
+		void _o_flags (const void* d, size_t len, int flags) { _o(d, len); } // No flags for compressed streams
+
+			// Read
+		size_t _i (void* d, size_t maxlen) { c->flush(*this, _raw_fncts().o); return c->read(*this, _raw_fncts().i, d, maxlen); }
+		void _i_fixsize (void* d, size_t len) { c->flush(*this, _raw_fncts().o); c->read_fixsize(*this, _raw_fncts().i, d, len); }
+
+		virtual base_fd::_io_fncts _get_io_fncts () { return base_fd::_io_fncts({ (base_fd::_io_fncts::i_fnct)&base_compressed::_i, (base_fd::_io_fncts::o_fnct)&base_compressed::_o, false }); }
+	};
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,164 @@
+#include <socket++/base_dgram.hpp>
+
+	// OS headers
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <errno.h>
+#include <stddef.h>
+#include <netinet/udp.h>
+
+namespace socketxx {
+
+	/************* BaseDgram Implementation *************/
+
+	namespace _base_dgram {
+
+#if defined(HAVE_RECVMMSG) or defined(HAVE_SENDMMSG)
+		static_assert(sizeof(mmsg) == sizeof(mmsghdr) and offsetof(mmsg, msg_len) == offsetof(mmsghdr, msg_len), "mmsg must have the layout of mmsghdr");
+#endif
+
+		void _bind (fd_t fd, const sockaddr* addr, socklen_t len, bool reuse_port) {
+			if (reuse_port) {
+			#ifdef SO_REUSEPORT
+				base_socket::_setopt_sock_bool(fd, SO_REUSEPORT, true);
+			#else
+				throw socketxx::error("SO_REUSEPORT not supported");
+			#endif
+			}
+			if (::bind(fd, addr, len) == -1)
+				throw socketxx::other_error("Failed to bind datagram socket");
+		}
+
+		void _connect (fd_t fd, const sockaddr* addr, socklen_t len) {
+			if (::connect(fd, addr, len) == -1)
+				throw socketxx::other_error("Failed to connect datagram socket");
+		}
+
+		size_t _recv (fd_t fd, mmsg* m, size_t n, bool wait, bool poll_mode, uint64_t deadline, io_stats* st) {
+			_io_stats::timer tm (st);
+			bool block = wait and not poll_mode;
+			for (;;) {
+				int r;
+			#ifdef HAVE_RECVMMSG
+				r = ::recvmmsg(fd, (mmsghdr*)m, (unsigned int)n, block ? MSG_WAITFORONE : MSG_DONTWAIT, NULL);
+			#else
+				r = 0;
+				for (size_t i = 0; i < n; i++) {
+					ssize_t k = ::recvmsg(fd, &m[i].msg_hdr, (i == 0 and block) ? 0 : MSG_DONTWAIT);
+					if (k == -1) {
+						if (i == 0) r = -1;
+						break;
+					}
+					m[i].msg_len = (unsigned int)k;
+					r++;
+				}
+			#endif
+				if (r == -1) {
+					if (errno == EINTR) continue;
+					if (errno == EAGAIN or errno == EWOULDBLOCK) {
+						if (not wait) return 0;
+						if (poll_mode) {
+							try {
+								_base_fd::_poll_wait(fd, POLLIN, deadline, io_error::READ);
+							} catch (...) { tm.read(-1); throw; }
+							continue;
+						}
+					}
+					tm.read(-1);
+					throw socketxx::io_error(-1, io_error::READ);
+				}
+				if (st != NULL) {
+					size_t bytes = 0;
+					for (int i = 0; i < r; i++)
+						bytes += m[i].msg_len;
+					tm.read((ssize_t)bytes);
+				}
+				return (size_t)r;
+			}
+		}
+
+		void _send (fd_t fd, mmsg* m, size_t n, bool poll_mode, uint64_t deadline, io_stats* st) {
+			_io_stats::timer tm (st);
+			int flags = MSG_NOSIGNAL | (poll_mode ? MSG_DONTWAIT : 0);
+			while (n != 0) {
+				int r;
+			#ifdef HAVE_SENDMMSG
+				r = ::sendmmsg(fd, (mmsghdr*)m, (unsigned int)n, flags);
+			#else
+				r = 0;
+				for (size_t i = 0; i < n; i++) {
+					ssize_t k = ::sendmsg(fd, &m[i].msg_hdr, flags);
+					if (k == -1) {
+						if (i == 0) r = -1;
+						break;
+					}
+					m[i].msg_len = (unsigned int)k;
+					r++;
+				}
+			#endif
+				if (r == -1) {
+					if (errno == EINTR) continue;
+					if (poll_mode and (errno == EAGAIN or errno == EWOULDBLOCK)) {
+						try {
+							_base_fd::_poll_wait(fd, POLLOUT, deadline, io_error::WRITE);
+						} catch (...) { tm.write(-1); throw; }
+						continue;
+					}
+					tm.write(-1);
+					throw socketxx::io_error(-1, io_error::WRITE);
+				}
+				if (st != NULL) {
+					size_t bytes = 0;
+					for (int i = 0; i < r; i++)
+						bytes += m[i].msg_len;
+					tm.write((ssize_t)bytes);
+				}
+				m += r;
+				n -= (size_t)r;
+			}
+		}
+
+		size_t _gro_seg (const msghdr& h) {
+		#ifdef UDP_GRO
+			if (h.msg_controllen == 0)
+				return 0;
+			for (cmsghdr* c = CMSG_FIRSTHDR(&h); c != NULL; c = CMSG_NXTHDR(const_cast<msghdr*>(&h), c)) {
+				if (c->cmsg_level == SOL_UDP and c->cmsg_type == UDP_GRO) {
+					int seg;
+					::memcpy(&seg, CMSG_DATA(c), sizeof(int));
+					return (size_t)seg;
+				}
+			}
+		#endif
+			return 0;
+		}
+
+		void _gso_cmsg (msghdr& h, char* ctl, size_t seg) {
+		#ifdef UDP_SEGMENT
+			h.msg_control = ctl;
+			h.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+			cmsghdr* c = CMSG_FIRSTHDR(&h);
+			c->cmsg_level = SOL_UDP;
+			c->cmsg_type = UDP_SEGMENT;
+			c->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+			uint16_t s = (uint16_t)seg;
+			::memcpy(CMSG_DATA(c), &s, sizeof(s));
+		#else
+			throw socketxx::error("UDP GSO not supported");
+		#endif
+		}
+
+		void _set_gro (fd_t fd, bool enable) {
+		#ifdef UDP_GRO
+			int v = enable;
+			if (::setsockopt(fd, SOL_UDP, UDP_GRO, &v, sizeof(v)) == -1)
+				throw socketxx::other_error("Failed to set UDP_GRO");
+		#else
+			if (enable) throw socketxx::error("UDP GRO not supported");
+		#endif
+		}
+
+	}
+
+}
@@ -0,0 +1,209 @@
+#ifndef SOCKET_XX_BASE_DGRAM_H
+#define SOCKET_XX_BASE_DGRAM_H
+
+	// BaseIO
+#include <socket++/base_io.hpp>
+
+	// General headers
+#include <vector>
+#include <string.h>
+
+	// OS headers
+#include <sys/uio.h>
+
+namespace socketxx {
+
+		// Private tools
+	namespace _base_dgram {
+			// Layout of Linux's mmsghdr
+		struct mmsg { msghdr msg_hdr; unsigned int msg_len; };
+			// Control data room per message : GRO/GSO segment size
+		const size_t ctl_sz = 32;
+
+		void _bind (fd_t fd, const sockaddr* addr, socklen_t len, bool reuse_port);
+		void _connect (fd_t fd, const sockaddr* addr, socklen_t len);
+			// Receive up to `n` messages with recvmmsg() (or a loop of recvmsg()). With `wait`, waits for at least one,
+			//  with poll() until `deadline` in `poll_mode`. Else returns 0 if none is waiting.
+		size_t _recv (fd_t fd, mmsg* m, size_t n, bool wait, bool poll_mode, uint64_t deadline, io_stats* st);
+			// Send `n` messages with sendmmsg() (or a loop of sendmsg())
+		void _send (fd_t fd, mmsg* m, size_t n, bool poll_mode, uint64_t deadline, io_stats* st);
+			// UDP generic segmentation (Linux) : segment size of a received message (0 if not coalesced), and sending
+		size_t _gro_seg (const msghdr& h);
+		void _gso_cmsg (msghdr& h, char* ctl, size_t seg);
+		void _set_gro (fd_t fd, bool enable);
+	}
+
+		///------ Base class for datagram sockets ------///
+	/*
+	 *  Datagram (SOCK_DGRAM) socket of the address family of `sock_base` : base_netsock (UDP) or base_unixsock.
+	 *  Datagrams are sent and received one by one, or by batches (recvmmsg()/sendmmsg() where available) in
+	 *   preallocated arrays : one syscall for many datagrams, and no allocation while receiving.
+	 *  With UDP GRO enabled (Linux), the kernel can coalesce datagrams of a same flow in one buffer : see batch::for_each().
+	 *   With GSO, one buffer is sent as many datagrams of a given size (see batch::push_gso()).
+	 *  Deadlines, I/O statistics and the read timeout apply to receptions as for stream sockets.
+	 *  Stream routines of base_socket are not meaningful here, datagram sockets can't be used with IO protocols.
+	 */
+	template <typename sock_base>
+	class base_dgram : public sock_base {
+	public:
+		typedef typename sock_base::addr_info addr_info;
+		typedef typename sock_base::sockaddr_type sockaddr_type;
+
+			/// Preallocated batch of datagrams : `n` buffers of `max_size` bytes in one block, with their headers and addresses.
+			///  Used for reception (i_batch) and sending (push, then o_batch). Not thread-safe.
+		class batch {
+			friend class base_dgram;
+			std::vector<_base_dgram::mmsg> m;
+			std::vector<iovec> iov;
+			std::vector<sockaddr_type> addrs;
+			std::vector<char> ctl;
+			char* buf;
+			const size_t n_max, sz_max;
+			size_t n;
+				// Reset headers of all messages for reception
+			void prep_recv () {
+				for (size_t i = 0; i < n_max; i++) {
+					iov[i].iov_len = sz_max;
+					msghdr& h = m[i].msg_hdr;
+					h.msg_name = &addrs[i];
+					h.msg_namelen = sizeof(sockaddr_type);
+					h.msg_control = &ctl[i*_base_dgram::ctl_sz];
+					h.msg_controllen = _base_dgram::ctl_sz;
+					h.msg_flags = 0;
+				}
+			}
+			msghdr& prep_send (const void* d, size_t len, const addr_info* to) {
+				::memcpy(buf + n*sz_max, d, len);
+				iov[n].iov_len = len;
+				msghdr& h = m[n].msg_hdr;
+				h.msg_control = NULL;
+				h.msg_controllen = 0;
+				h.msg_flags = 0;
+				if (to != NULL) {
+					typename sock_base::_addrt a = const_cast<addr_info*>(to)->_getaddr();
+					addrs[n] = a.addr;
+					h.msg_name = &addrs[n];
+					h.msg_namelen = a.len;
+				} else {
+					h.msg_name = NULL;
+					h.msg_namelen = 0;
+				}
+				return h;
+			}
+		public:
+			batch (size_t n, size_t max_size) : m(n), iov(n), addrs(n), ctl(n*_base_dgram::ctl_sz), buf(new char[n*max_size]), n_max(n), sz_max(max_size), n(0) {
+				::memset(m.data(), 0, n*sizeof(_base_dgram::mmsg));
+				for (size_t i = 0; i < n; i++) {
+					iov[i].iov_base = buf + i*max_size;
+					m[i].msg_hdr.msg_iov = &iov[i];
+					m[i].msg_hdr.msg_iovlen = 1;
+				}
+			}
+			batch (const batch&) = delete;
+			batch& operator= (const batch&) = delete;
+			~batch () { delete[] buf; }
+
+			size_t capacity () const { return n_max; }
+			size_t max_size () const { return sz_max; }
+				// Datagrams received, or queued for sending
+			size_t count () const { return n; }
+			void clear () { n = 0; }
+
+				// Received datagrams
+			const void* data (size_t i) const { return buf + i*sz_max; }
+			size_t len (size_t i) const       { return m[i].msg_len; }
+			bool truncated (size_t i) const   { return (m[i].msg_hdr.msg_flags & MSG_TRUNC) != 0; } // Buffer was too small
+			addr_info addr (size_t i) const   { return addr_info(typename sock_base::_addrt({ addrs[i], m[i].msg_hdr.msg_namelen })); } // Sender
+				// GRO : the buffer holds datagrams of this size, the last one can be shorter. 0 if it holds one datagram.
+			size_t seg_size (size_t i) const  { return _base_dgram::_gro_seg(m[i].msg_hdr); }
+				// Call `f(const void* data, size_t len, size_t i)` for each received datagram, splitting GRO buffers
+			template <typename F> void for_each (F f) const {
+				for (size_t i = 0; i < n; i++) {
+					const char* p = buf + i*sz_max;
+					size_t l = m[i].msg_len, seg = this->seg_size(i);
+					if (seg == 0) { f((const void*)p, l, i); continue; }
+					for (size_t o = 0; o < l; o += seg)
+						f((const void*)(p+o), (l-o < seg) ? l-o : seg, i);
+				}
+			}
+
+				// Queue a datagram for sending, to the connected peer or to `to`. Returns false if full or too big.
+			bool push (const void* d, size_t len)                      { if (n == n_max or len > sz_max) return false; this->prep_send(d, len, NULL); n++; return true; }
+			bool push (const void* d, size_t len, const addr_info& to) { if (n == n_max or len > sz_max) return false; this->prep_send(d, len, &to); n++; return true; }
+				// GSO : `len` bytes sent as datagrams of `seg_size` bytes (the last one can be shorter), in one buffer
+			bool push_gso (const void* d, size_t len, size_t seg_size, const addr_info* to = NULL) {
+				if (n == n_max or len > sz_max) return false;
+				msghdr& h = this->prep_send(d, len, to);
+				_base_dgram::_gso_cmsg(h, &ctl[n*_base_dgram::ctl_sz], seg_size);
+				n++;
+				return true;
+			}
+		};
+
+	protected:
+			// Private initialization
+		base_dgram (bool autoclose_handle, socket_t handle) : sock_base(autoclose_handle, handle) {}
+
+	public:
+			// Create a new datagram socket
+		base_dgram () : sock_base(true, base_socket::create_socket(sock_base::addr_family, SOCK_DGRAM)) {}
+			// Copy and move
+		base_dgram (const base_dgram&) = default;
+		base_dgram (base_dgram&& o) noexcept : sock_base(std::move(o)) {}
+		virtual ~base_dgram () noexcept {}
+
+			// Bind to a local address (to receive), optionally shared with other sockets with SO_REUSEPORT (the kernel balances datagrams)
+		void bind (addr_info a, bool reuse_port = false) { auto _a = a._getaddr(); _a.use(_addr_use_type_t::SERVER, *this); _base_dgram::_bind(this->fd, (const sockaddr*)&_a.addr, _a.len, reuse_port); }
+			// Set the default peer (to send without address), and only receive from it
+		void connect (addr_info a)       { auto _a = a._getaddr(); _base_dgram::_connect(this->fd, (const sockaddr*)&_a.addr, _a.len); }
+
+			// Single datagrams. Received ones bigger than `maxlen` are truncated.
+		void o_dgram (const void* d, size_t len)                      { batch_1 b (d, len, NULL); _base_dgram::_send(this->fd, &b.m, 1, this->_wait_mode(), this->shd->deadline, this->shd->stats); }
+		void o_dgram (const void* d, size_t len, const addr_info& to) { batch_1 b (d, len, &to); _base_dgram::_send(this->fd, &b.m, 1, this->_wait_mode(), this->shd->deadline, this->shd->stats); }
+		size_t i_dgram (void* d, size_t maxlen, sockaddr_type* from = NULL) {
+			_base_dgram::mmsg m; iovec v = { d, maxlen };
+			::memset(&m, 0, sizeof(m));
+			m.msg_hdr.msg_iov = &v; m.msg_hdr.msg_iovlen = 1;
+			if (from != NULL) { m.msg_hdr.msg_name = from; m.msg_hdr.msg_namelen = sizeof(sockaddr_type); }
+			_base_dgram::_recv(this->fd, &m, 1, true, this->_wait_mode(), this->_rcv_deadline(), this->shd->stats);
+			return m.msg_len;
+		}
+
+			// Batches. i_batch() replaces the content of `b` with up to `b.capacity()` datagrams, waiting for at least
+			//  one if `wait`. Returns the count. o_batch() sends all queued datagrams and clears the batch.
+		size_t i_batch (batch& b, bool wait = true) {
+			b.prep_recv();
+			b.n = _base_dgram::_recv(this->fd, b.m.data(), b.n_max, wait, this->_wait_mode(), this->_rcv_deadline(), this->shd->stats);
+			return b.n;
+		}
+		void o_batch (batch& b) {
+			_base_dgram::_send(this->fd, b.m.data(), b.n, this->_wait_mode(), this->shd->deadline, this->shd->stats);
+			b.n = 0;
+		}
+
+			// UDP GRO : receive coalesced datagrams (Linux >= 5.0). Buffers should be 64KiB.
+		void set_gro (bool enable) { _base_dgram::_set_gro(this->fd, enable); }
+			// Kernel socket buffers (SO_RCVBUF/SO_SNDBUF) : high datagram rates need big receive buffers
+		void set_rcvbuf (int sz) { base_socket::_setopt_sock(this->fd, SO_RCVBUF, &sz, sizeof(sz)); }
+		void set_sndbuf (int sz) { base_socket::_setopt_sock(this->fd, SO_SNDBUF, &sz, sizeof(sz)); }
+
+	private:
+			// Header of one datagram to send
+		struct batch_1 {
+			_base_dgram::mmsg m; iovec v; sockaddr_type a;
+			batch_1 (const void* d, size_t len, const addr_info* to) {
+				::memset(&m, 0, sizeof(m));
+				v.iov_base = const_cast<void*>(d); v.iov_len = len;
+				m.msg_hdr.msg_iov = &v; m.msg_hdr.msg_iovlen = 1;
+				if (to != NULL) {
+					typename sock_base::_addrt _a = const_cast<addr_info*>(to)->_getaddr();
+					a = _a.addr;
+					m.msg_hdr.msg_name = &a; m.msg_hdr.msg_namelen = _a.len;
+				}
+			}
+		};
+	};
+
+}
+
+#endif
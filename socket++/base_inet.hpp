@@ -46,6 +46,11 @@ namespace socketxx {
 		
 			// Contructor from base_socket - underlying socket must have AF_INET family
 		base_netsock (const socketxx::base_socket& o) : base_socket(o) {}
+			// Copy and move
+		base_netsock (const base_netsock&) = default;
+		base_netsock (base_netsock&& o) noexcept : base_socket(std::move(o)) {}
+		base_netsock& operator= (const base_netsock&) = default;
+		base_netsock& operator= (base_netsock&&) = default;
 		
 			// Destuctor
 		virtual ~base_netsock () noexcept {}
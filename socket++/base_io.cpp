@@ -11,13 +11,61 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/select.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <time.h>
+#include <limits.h>
 
 namespace socketxx {
 	
 	/** -------------- BaseFD Implementation -------------- **/
 	
+		// Deadlines
+	void _base_fd::_poll_wait (fd_t fd, short events, uint64_t deadline, io_error::_type t) {
+		for (;;) {
+			int ms = -1;
+			bool last = false;
+			if (deadline != 0) {
+				uint64_t now = _io_stats::now_ns();
+				if (now >= deadline) {
+					ms = 0;
+					last = true;
+				} else {
+					uint64_t left = (deadline - now + 999999) / 1000000;
+					ms = (left > INT_MAX) ? INT_MAX : (int)left;
+				}
+			}
+			pollfd p = { fd, events, 0 };
+			int r = ::poll(&p, 1, ms);
+			if (r > 0) 
+				return; // Including errors and hang-ups, reported by the following call
+			if (r == -1) {
+				if (errno == EINTR) continue;
+				throw socketxx::io_error(-1, t);
+			}
+			if (last) {
+				errno = ETIMEDOUT;
+				throw socketxx::io_error(-1, t);
+			}
+		}
+	}
+	uint64_t _base_fd::_min_deadline (uint64_t deadline, timeval timeout) {
+		if (timeout == TIMEOUT_INF) 
+			return deadline;
+		uint64_t tm = _io_stats::now_ns() + (uint64_t)timeout.tv_sec*1000000000 + (uint64_t)timeout.tv_usec*1000;
+		return (deadline != 0 and deadline < tm) ? deadline : tm;
+	}
+	timeval base_fd::deadline_left () const {
+		if (shd->deadline == 0) 
+			return TIMEOUT_INF;
+		uint64_t now = _io_stats::now_ns();
+		if (now >= shd->deadline) 
+			return timeval({0,0});
+		uint64_t left = shd->deadline - now;
+		return timeval({ (time_t)(left / 1000000000), (suseconds_t)(left % 1000000000) / 1000 });
+	}
+	
 		// Flag operations
 	int base_fd::fcntl_fl::get () const {
 		int flags = ::fcntl(fd, F_GETFL);
@@ -43,6 +91,8 @@ namespace socketxx {
 	
 		// Data availability
 	bool base_fd::i_avail () {
+		if (this->i_buffered() != 0)
+			return true;
 		fd_set fdset;
 		int r;
 		timeval tm = {0,0};
@@ -61,39 +111,114 @@ namespace socketxx {
 			fd = SOCKETXX_INVALID_HANDLE;
 		}
 	}
-	base_fd::~base_fd () noexcept {
-		REFCXX_DESTRUCT(base_fd) {
+	void base_fd::_release () noexcept {
+		if (shd != NULL and shd->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
 			fd_close();
 			delete shd;
 		}
+		shd = NULL;
+	}
+	base_fd::~base_fd () noexcept {
+		this->_release();
 	}
 	
-	void base_fd::_o (const void* d, size_t len) {
-		ssize_t r;
-		r = ::write(fd, d, len);
-		if (r != (ssize_t)len) throw socketxx::io_error(r, io_error::WRITE);
+		// Assignment
+	base_fd& base_fd::operator= (const base_fd& o) noexcept {
+		if (shd != o.shd) {
+			if (o.shd != NULL) 
+				o.shd->refs.fetch_add(1, std::memory_order_relaxed);
+			this->_release();
+			shd = o.shd;
+		}
+		fd = o.fd;
+		return *this;
+	}
+	base_fd& base_fd::operator= (base_fd&& o) noexcept {
+		if (this != &o) {
+			this->_release();
+			fd = o.fd; shd = o.shd;
+			o.fd = SOCKETXX_INVALID_HANDLE; o.shd = NULL;
+		}
+		return *this;
+	}
+	
+	void _base_fd::_set_nonblock (fd_t fd) {
+		int fl = ::fcntl(fd, F_GETFL);
+		if (fl == -1 or ::fcntl(fd, F_SETFL, fl | O_NONBLOCK) == -1)
+			throw socketxx::other_error("Failed to set file descriptor in non-blocking mode");
+	}
+	void base_fd::_fd_nonblock () {
+		if (not shd->nonblock and shd->deadline != 0) {
+			_base_fd::_set_nonblock(fd);
+			shd->nonblock = true;
+		}
+	}
+	
+	void base_fd::_o (const void* d, size_t len) { // Partial writes are completed
+		const char* data = (const char*)d;
+		_io_stats::timer tm (shd->stats);
+		this->_fd_nonblock(); // poll() only tells that some space is free : a blocking write() could outlast the deadline
+		while (len != 0) {
+			ssize_t r = ::write(fd, data, len);
+			if (r == -1 and errno == EINTR) continue;
+			if (r == -1 and shd->nonblock and (errno == EAGAIN or errno == EWOULDBLOCK)) {
+				try {
+					_base_fd::_poll_wait(fd, POLLOUT, shd->deadline, io_error::WRITE);
+				} catch (...) { tm.write(-1); throw; }
+				continue;
+			}
+			tm.write(r);
+			if (r < 1) throw socketxx::io_error(r, io_error::WRITE);
+			data += r;
+			len -= (size_t)r;
+		}
 	}
 	
 	size_t base_fd::_i (void* d, size_t maxlen) {
 		ssize_t r;
-		r = ::read(fd, d, maxlen);
+		_io_stats::timer tm (shd->stats);
+		if (shd->deadline != 0) {
+			try {
+				_base_fd::_poll_wait(fd, POLLIN, shd->deadline, io_error::READ);
+			} catch (...) { tm.read(-1); throw; }
+		}
+		while ((r = ::read(fd, d, maxlen)) == -1) {
+			if (errno == EINTR) continue;
+			if (not shd->nonblock or (errno != EAGAIN and errno != EWOULDBLOCK)) break;
+			try { // Non-blocking since a write deadline
+				_base_fd::_poll_wait(fd, POLLIN, shd->deadline, io_error::READ);
+			} catch (...) { tm.read(-1); throw; }
+		}
+		tm.read(r);
 		if (r <= 0) throw socketxx::io_error(r, io_error::READ);
 		return (size_t)r;
 	}
 	void base_fd::_i_fixsize (void* d, size_t len) {
-		ssize_t r;
 		char* data = (char*)d;
-		r = ::read(fd, data, len);
-		if (r <= 0) throw socketxx::io_error(r, io_error::READ);
-		if ((size_t)r < len) {
-			size_t rest = len - (size_t)r;
-			data += r;
-			while (rest != 0) {
-				r = ::read(fd, data, len);
-				if (r <= 1) throw socketxx::io_error(r, io_error::READ);
-				data += r;
-				rest -= (size_t)r;
+		_io_stats::timer tm (shd->stats);
+		bool first = true;
+		while (len != 0) {
+			if (shd->deadline != 0) {
+				try {
+					_base_fd::_poll_wait(fd, POLLIN, shd->deadline, io_error::READ);
+				} catch (...) { tm.read(-1); throw; }
 			}
+			ssize_t r = ::read(fd, data, len);
+			if (r == -1 and errno == EINTR) continue;
+			if (r == -1 and shd->nonblock and (errno == EAGAIN or errno == EWOULDBLOCK)) { // Non-blocking since a write deadline
+				if (shd->deadline == 0) {
+					try {
+						_base_fd::_poll_wait(fd, POLLIN, 0, io_error::READ);
+					} catch (...) { tm.read(-1); throw; }
+				}
+				continue;
+			}
+			tm.read(r);
+			if (r <= 0) throw socketxx::io_error(r, io_error::READ);
+			data += r;
+			len -= (size_t)r;
+			if (first and len != 0) tm.short_read();
+			first = false;
 		}
 	}
 	
@@ -109,54 +234,118 @@ namespace socketxx {
 		mode_t fd_mode = statbuf.st_mode;
 		if (not S_ISFIFO(fd_mode))
 			throw socketxx::error("File descriptor is not a pipe");
-		if ((fd_mode & S_IRUSR) != (rw == rw_t::READ))
+		int fl = ::fcntl(fd, F_GETFL);
+		if (fl == -1)
+			throw socketxx::other_error("Error getting file descriptor's flags with fcntl(F_GETFL)");
+		int acc = fl & O_ACCMODE;
+		if (acc != O_RDWR and acc != ((rw == rw_t::READ) ? O_RDONLY : O_WRONLY)) // FIFOs opened read-write (Linux) can be used as both ends
 			throw socketxx::error("Pipe end mode incompatible with specified rw_t");
 	}
 	
-	void _base_pipe::_pipe_select_wait (fd_t fd, timeval* tm) {
-		fd_set select_set;
-		int r_sel;
-	select_redo:
-		FD_ZERO(&select_set);
-		FD_SET(fd, &select_set);
-		r_sel = ::select(fd+1, &select_set, NULL, NULL, tm);
-		if (r_sel == -1) {
-			if (errno == EINTR) goto select_redo;
-			throw socketxx::io_error(-1, io_error::READ);
+	size_t _base_pipe::_i_pipe (fd_t fd, void* d, size_t maxlen, timeval tm, uint64_t deadline, bool nonblock, io_stats* st) {
+		_io_stats::timer stm (st);
+		bool wait = (tm != TIMEOUT_INF or deadline != 0);
+		uint64_t dl = wait ? _base_fd::_min_deadline(deadline, tm) : 0;
+		if (wait and not nonblock) {
+			try {
+				_base_fd::_poll_wait(fd, POLLIN, dl, io_error::READ);
+			} catch (...) { stm.read(-1); throw; }
 		}
-		if (r_sel == 0) {
-			errno = ETIMEDOUT;
-			throw socketxx::io_error(-1, io_error::READ);
-		}
-		return;
-	}
-	
-	size_t _base_pipe::_i_pipe (fd_t fd, void* d, size_t maxlen, timeval tm) {
-		if (tm != TIMEOUT_INF)
-			_base_pipe::_pipe_select_wait(fd, &tm);
 		ssize_t r;
-		r = ::read(fd, d, maxlen);
+		while ((r = ::read(fd, d, maxlen)) == -1) {
+			if (errno == EINTR) continue;
+			if (not nonblock or (errno != EAGAIN and errno != EWOULDBLOCK)) break;
+			try {
+				_base_fd::_poll_wait(fd, POLLIN, dl, io_error::READ);
+			} catch (...) { stm.read(-1); throw; }
+		}
+		stm.read(r);
 		if (r <= 0) throw socketxx::io_error(r, io_error::READ);
 		return (size_t)r;
 	}
-	void _base_pipe::_ifix_pipe (fd_t fd, void* d, size_t len, timeval tm) {
+	void _base_pipe::_ifix_pipe (fd_t fd, void* d, size_t len, timeval tm, uint64_t deadline, bool nonblock, io_stats* st) {
 		ssize_t r;
 		char* data = (char*)d;
+		_io_stats::timer stm (st);
+		bool wait = (tm != TIMEOUT_INF or deadline != 0);
+		bool first = true;
 		while (len != 0) {
-			if (tm != TIMEOUT_INF)
-				_base_pipe::_pipe_select_wait(fd, &tm);
+			if (wait and not nonblock) { // Timeout is reset for each chunk, deadline is strict
+				try {
+					_base_fd::_poll_wait(fd, POLLIN, _base_fd::_min_deadline(deadline, tm), io_error::READ);
+				} catch (...) { stm.read(-1); throw; }
+			}
 			r = ::read(fd, data, len);
+			if (r == -1 and errno == EINTR) continue;
+			if (r == -1 and nonblock and (errno == EAGAIN or errno == EWOULDBLOCK)) { // Empty pipe : wait for next chunk
+				try {
+					_base_fd::_poll_wait(fd, POLLIN, wait ? _base_fd::_min_deadline(deadline, tm) : 0, io_error::READ);
+				} catch (...) { stm.read(-1); throw; }
+				continue;
+			}
+			stm.read(r);
 			if (r <= 0) throw socketxx::io_error(r, io_error::READ);
 			data += r;
 			len -= (size_t)r;
+			if (first and len != 0) stm.short_read();
+			first = false;
+		}
+	}
+	
+	size_t _base_pipe::_set_pipe_size (fd_t fd, size_t sz) {
+	#ifdef F_SETPIPE_SZ
+		int r = ::fcntl(fd, F_SETPIPE_SZ, (int)((sz > INT_MAX) ? INT_MAX : sz));
+		if (r == -1)
+			throw socketxx::other_error("Failed to set pipe size with fcntl(F_SETPIPE_SZ)");
+		return (size_t)r;
+	#else
+		throw socketxx::error("Pipe size can't be set on this system");
+	#endif
+	}
+	size_t _base_pipe::_get_pipe_size (fd_t fd) {
+	#ifdef F_GETPIPE_SZ
+		int r = ::fcntl(fd, F_GETPIPE_SZ);
+		if (r == -1)
+			throw socketxx::other_error("Failed to get pipe size with fcntl(F_GETPIPE_SZ)");
+		return (size_t)r;
+	#else
+		throw socketxx::error("Pipe size can't be queried on this system");
+	#endif
+	}
+	
+	void _base_pipe::_o_vmsplice (fd_t fd, const void* d, size_t len, uint64_t deadline, io_stats* st) {
+		iovec v = { const_cast<void*>(d), len };
+		_io_stats::timer tm (st);
+		while (v.iov_len != 0) {
+			if (deadline != 0) {
+				try {
+					_base_fd::_poll_wait(fd, POLLOUT, deadline, io_error::WRITE);
+				} catch (...) { tm.write(-1); throw; }
+			}
+		#ifdef HAVE_VMSPLICE
+			ssize_t r = ::vmsplice(fd, &v, 1, 0);
+		#else
+			ssize_t r = ::write(fd, v.iov_base, v.iov_len);
+		#endif
+			if (r == -1 and errno == EINTR) continue;
+			if (r == -1 and (errno == EAGAIN or errno == EWOULDBLOCK)) { // Write end in non-blocking mode
+				try {
+					_base_fd::_poll_wait(fd, POLLOUT, deadline, io_error::WRITE);
+				} catch (...) { tm.write(-1); throw; }
+				continue;
+			}
+			tm.write(r);
+			if (r < 1) throw socketxx::io_error(r, io_error::WRITE);
+			v.iov_base = (char*)v.iov_base + r;
+			v.iov_len -= (size_t)r;
 		}
 	}
 	
 		/** -------------- BaseSocket Implementation -------------- **/
 	
 		// Socket creation
-	fd_t base_socket::create_socket (sa_family_t af) {
-		fd_t fd = ::socket((sa_family_t)af, SOCK_STREAM, 0);
+	fd_t base_socket::create_socket (sa_family_t af, int type) {
+		fd_t fd = ::socket((sa_family_t)af, type, 0);
 		if (fd == -1) throw socketxx::other_error("Failed to create socket");
 		return fd;
 	}
@@ -177,7 +366,7 @@ namespace socketxx {
 		}
 	}
 	base_socket::~base_socket () noexcept {
-		REFCXX_WILL_DESTRUCT(base_fd) {
+		if (this->_last_ref()) {
 			fd_close();
 		}
 	}
@@ -211,63 +400,97 @@ namespace socketxx {
 		#warning TO DO : Implement non blocking calls
 		if (timeout == TIMEOUT_NOBLOCK)
 			throw socketxx::error("set_read_timeout : non blocking IO ops not supported");
-		if (timeout == TIMEOUT_INF)
-			timeout = {0,0};
-		this->_setopt_sock(fd, SO_RCVTIMEO, &timeout, sizeof(timeval));
+		if (timeout == shd->rcvtimeo)
+			return;
+		timeval tm = (timeout == TIMEOUT_INF) ? timeval({0,0}) : timeout;
+		this->_setopt_sock(fd, SO_RCVTIMEO, &tm, sizeof(timeval));
+		shd->rcvtimeo = timeout;
 	}
 	timeval base_socket::get_read_timeout () const {
+		if (shd->rcvtimeo.tv_sec != -2)
+			return shd->rcvtimeo;
 		timeval tm = {0};
 		this->_getopt_sock(fd, SO_RCVTIMEO, &tm, sizeof(timeval));
 		if (tm == timeval({0,0}))
 			tm = TIMEOUT_INF;
+		shd->rcvtimeo = tm;
 		return tm;
 	}
 	
 		/// Common I/O routines
 	
-		// Send
+		// Send. Partial sends are completed.
 	void base_socket::_o (const void* d, size_t len) { // Normal send()
-		ssize_t r;
-		r = ::send(fd, d, len, MSG_NOSIGNAL);
-		if (r < (ssize_t)len) throw socketxx::io_error(r, io_error::WRITE);
+		this->_o_flags(d, len, 0);
 	}
 	void base_socket::_o_flags (const void* d, size_t len, int flags) { // send() with flags
-		ssize_t r;
-		r = ::send(fd, d, len, flags|MSG_NOSIGNAL);
-		if (r < (ssize_t)len) throw socketxx::io_error(r, io_error::WRITE);
+		const char* data = (const char*)d;
+		_io_stats::timer tm (shd->stats);
+		bool wait = this->_wait_mode();
+		flags |= MSG_NOSIGNAL | (wait ? MSG_DONTWAIT : 0);
+		while (len != 0) {
+			ssize_t r = ::send(fd, data, len, flags);
+			if (r == -1 and errno == EINTR) continue;
+			if (r == -1 and wait and (errno == EAGAIN or errno == EWOULDBLOCK)) {
+				try {
+					_base_fd::_poll_wait(fd, POLLOUT, shd->deadline, io_error::WRITE);
+				} catch (...) { tm.write(-1); throw; }
+				continue;
+			}
+			tm.write(r);
+			if (r < 1) throw socketxx::io_error(r, io_error::WRITE);
+			data += r;
+			len -= (size_t)r;
+		}
 	}
 	
 		// Receive
 	size_t base_socket::_i (void* d, size_t maxlen) {
 		ssize_t r;
-		r = ::recv(fd, d, maxlen, MSG_NOSIGNAL);
+		_io_stats::timer tm (shd->stats);
+		if (not this->_wait_mode()) {
+			r = ::recv(fd, d, maxlen, MSG_NOSIGNAL);
+		} else {
+			while ((r = ::recv(fd, d, maxlen, MSG_NOSIGNAL|MSG_DONTWAIT)) == -1) {
+				if (errno == EINTR) continue;
+				if (errno != EAGAIN and errno != EWOULDBLOCK) break;
+				try {
+					_base_fd::_poll_wait(fd, POLLIN, this->_rcv_deadline(), io_error::READ);
+				} catch (...) { tm.read(-1); throw; }
+			}
+		}
+		tm.read(r);
 		if (r < 1) throw socketxx::io_error(r, io_error::READ);
 		return (size_t)r;
 	}
-#ifndef MSG_WAITALL
-	void base_socket::_i_fixsize (void* d, size_t len) { // Returns only if [len] data is read
-		ssize_t r;
+	void base_socket::_i_fixsize (void* d, size_t len) { // Returns only if [len] data is read. Use MSG_WAITALL in blocking mode.
+#ifdef MSG_WAITALL
+		const int waitall = MSG_WAITALL;
+#else
+		const int waitall = 0;
+#endif
 		char* data = (char*)d;
-		r = ::recv(fd, data, len, MSG_NOSIGNAL);
-		if (r < 1) throw socketxx::io_error(r, io_error::READ);
-		if ((size_t)r < len) {
-			size_t rest = len - r;
-			data += r;
-			while (rest != 0) {
-				r = ::recv(fd, data, len, MSG_NOSIGNAL);
-				if (r < 1) throw socketxx::io_error(r, io_error::READ);
-				data += r;
-				rest -= r;
+		_io_stats::timer tm (shd->stats);
+		bool wait = this->_wait_mode();
+		int flags = MSG_NOSIGNAL | (wait ? MSG_DONTWAIT : waitall);
+		bool first = true;
+		while (len != 0) {
+			ssize_t r = ::recv(fd, data, len, flags);
+			if (r == -1 and errno == EINTR) continue;
+			if (r == -1 and wait and (errno == EAGAIN or errno == EWOULDBLOCK)) {
+				try {
+					_base_fd::_poll_wait(fd, POLLIN, this->_rcv_deadline(), io_error::READ);
+				} catch (...) { tm.read(-1); throw; }
+				continue;
 			}
+			tm.read(r);
+			if (r < 1) throw socketxx::io_error(r, io_error::READ);
+			data += r;
+			len -= (size_t)r;
+			if (first and len != 0) tm.short_read();
+			first = false;
 		}
 	}
-#else
-	void base_socket::_i_fixsize (void* d, size_t len) { // Returns only if [len] data is read, Use MSG_WAITALL
-		ssize_t r;
-		r = ::recv(fd, d, len, MSG_NOSIGNAL|MSG_WAITALL);
-		if (r < (ssize_t)len) throw socketxx::io_error(r, io_error::READ);
-	}
-#endif
 	
 		/** -------------- Exceptions -------------- **/
 	
@@ -22,6 +22,8 @@
  *      - BaseNetSock : TCP/IP sockets (AF_INET)
  *        - BaseSSL : handler for SSL sockets : SSL mode can be switched on/off at any time
  *      - BaseUnixSock : UNIX (local) sockets (AF_UNIX)
+ *        - BaseUnixSeq : UNIX sequenced-packet sockets (SOCK_SEQPACKET), keeping message boundaries
+ *      - BaseDgram : datagram sockets (UDP, UNIX), with batched reception and sending
  *    - BasePipe : handler for UNIX pipes / Windows Named pipes / Windows anonymous pipes
  *    - BaseFile : handler for files and virtual files like stdin/stdout
  *
@@ -37,9 +39,12 @@
  *                      It is perfect for personal & simple protocols, with good performances.
  *    - Stoppable Simple Socket : Overloaded Simple Socket for event paradigm. The read waiting 
  *                                operation can be stopped by an another file descriptor, 
- *                                for example a pipe between threads, or stdio.
+ *                                for example a pipe between threads, an eventfd, or stdio.
+ *                                It is simple_socket on base_stoppable, which works with any IO protocol.
  *    - Text Socket : For use of plain old textual protocols like SMTP or HTTP.
  *                      You can define the line ending freely. It is line-oriented.
+ *    - Framed Socket : Message-oriented. Length-prefixed binary frames, read ahead in a reused buffer
+ *                      and returned as views without copy. Fast base for binary RPC protocols.
  *    - Tunnel : simply copy data between two streams, using, if possible, zero-copy facilities
  * 
  * These IO protocols are used with Connection Handlers (or 'ends'). A Connection Handler is only responsible 
@@ -55,6 +60,9 @@
  *         be processed by a callback funtion, or one by one.
  *    - The socket "client" side, or outcoming side :
  *        Simply connects to a specified address.
+ *    - RPC multiplexer :
+ *        Request/response messages tagged with IDs over one connection : many threads can have requests
+ *         pending at once, responses are dispatched by a reader thread to futures or callbacks.
  * 
  * A complete (usable) socket++ object is declared like this : ConnectionHandler<IOProtocol<BaseIO>>
  * Example : socketxx::handler_socket::client<socketxx::io::simple_socket<socketxx::base_ssl>> cli(...);
@@ -82,10 +90,15 @@
  * - socketxx::event,error exceptions */
 #include <socket++/defs.hpp>
 
+	// I/O statistics
+#include <socket++/io_stats.hpp>
+
 	// OS headers
 #include <sys/socket.h>
 #include <string>
 #include <stdexcept>
+#include <atomic>
+#include <utility>
 
 namespace socketxx {
 	
@@ -154,43 +167,71 @@ namespace socketxx {
 		virtual ~other_error() noexcept {}
 	};
 	
+		// Private tools
+	namespace _base_fd {
+			// Wait for `events` (POLLIN, POLLOUT) on `fd` until `deadline` (0 : no deadline). Polls at least once.
+			//  Throws io_error of type `t` with ETIMEDOUT once the deadline is passed.
+		void _poll_wait (fd_t fd, short events, uint64_t deadline, io_error::_type t);
+			// Earliest of a deadline and a timeout from now (TIMEOUT_INF : no timeout). 0 if none.
+		uint64_t _min_deadline (uint64_t deadline, timeval timeout);
+			// Set O_NONBLOCK
+		void _set_nonblock (fd_t);
+	}
+	
 		///-------------------------------------------------///
 		///------ Base class for any file descriptors ------///
 	class base_fd {
 	protected:
-			// Using refcounting
-		REFCXX_REFCOUNTED(base_fd);
 		
 			// The file descriptor
 		fd_t fd;
-			// Shared socket settings
+			// Shared socket settings, with the reference count of the copies : one allocation per socket
 		struct _shrd_data {
+			// Copies sharing the fd and these settings
+			std::atomic<unsigned> refs;
 			// Autoclose file descriptor
 			bool autoclose;
 			// Preserve the inode from future automatic actions
 			bool preserve_fd;
+			// I/O statistics, NULL if disabled
+			io_stats* stats;
+			// I/O deadline (CLOCK_MONOTONIC, in ns), 0 if none
+			uint64_t deadline;
+			// The fd was set in non-blocking mode by socket++ : I/O routines wait with poll()
+			bool nonblock;
+			// Cached SO_RCVTIMEO of sockets, `tv_sec` is -2 if not known yet
+			timeval rcvtimeo;
 /*			// Aggregation
  uint8_t cork_lvl;
  // http://baus.net/on-tcp_cork/
  #warning TO DO : multithreading, TCP_CORK*/
-			_shrd_data () : autoclose(true), preserve_fd(false) {}
-			_shrd_data (bool autoclose) : autoclose(autoclose), preserve_fd(false) {}
-		} * shd;
+			_shrd_data () : refs(1), autoclose(true), preserve_fd(false), stats(NULL), deadline(0), nonblock(false), rcvtimeo({-2,0}) {}
+			_shrd_data (bool autoclose) : refs(1), autoclose(autoclose), preserve_fd(false), stats(NULL), deadline(0), nonblock(false), rcvtimeo({-2,0}) {}
+			~_shrd_data () { delete stats; }
+		} * shd; // NULL in a moved-from object
 		
 			// Private initialization
-		base_fd (fd_t handle) : REFCXX_CONSTRUCTOR(base_fd), fd(handle), shd(new _shrd_data()) {}
-		base_fd (bool autoclose_handle, fd_t handle) : REFCXX_CONSTRUCTOR(base_fd), fd(handle), shd(new _shrd_data(autoclose_handle)) {}  // Don't forget to check file descriptor
+		base_fd (fd_t handle) : fd(handle), shd(new _shrd_data()) {}
+		base_fd (bool autoclose_handle, fd_t handle) : fd(handle), shd(new _shrd_data(autoclose_handle)) {}  // Don't forget to check file descriptor
 		static void check_fd (fd_t);
 		
+			// Reference counting : the last copy closes the fd. Derived classes' destructors test _last_ref() before closing,
+			//  base_fd's one drops the reference. Moved-from objects have no reference.
+		bool _last_ref () const noexcept { return shd != NULL and shd->refs.load(std::memory_order_acquire) == 1; }
+		void _release () noexcept;
+		
 	public:
 			// Public constructors with already created file descriptor
 		#define SOCKETXX_AUTO_CLOSE (bool)true
 		#define SOCKETXX_MANUAL_FD (bool)false
-		base_fd (fd_t handle, bool autoclose_handle) : REFCXX_CONSTRUCTOR(base_fd), fd(handle), shd(new _shrd_data(autoclose_handle)) { base_fd::check_fd(handle); }
+		base_fd (fd_t handle, bool autoclose_handle) : fd(handle), shd(new _shrd_data(autoclose_handle)) { base_fd::check_fd(handle); }
 			// Copy constructor (with reference counting) /!\ base_fd::fd is not const, do NOT copy before the socket is connected or binded !
-		base_fd (const base_fd& o) : REFCXX_COPY_CONSTRUCTOR(base_fd, o), fd(o.fd), shd(o.shd) {}
-			// Assign reconstructor
-		REFCXX_ASSIGN(base_fd);
+		base_fd (const base_fd& o) noexcept : fd(o.fd), shd(o.shd) { if (shd != NULL) shd->refs.fetch_add(1, std::memory_order_relaxed); }
+			// Move constructor : takes the reference of `o`, which is left empty and can only be destructed or assigned
+		base_fd (base_fd&& o) noexcept : fd(o.fd), shd(o.shd) { o.fd = SOCKETXX_INVALID_HANDLE; o.shd = NULL; }
+			// Assignment : drops the current reference (closing the fd if last, as base_fd would)
+		base_fd& operator= (const base_fd& o) noexcept;
+		base_fd& operator= (base_fd&& o) noexcept;
 		
 			// Destuctor
 		protected: void fd_close () noexcept;
@@ -201,6 +242,29 @@ namespace socketxx {
 			// Preserve the inode from future automatic actions
 		void set_preserved () { shd->preserve_fd = true; }
 		
+			// I/O statistics (bytes, calls, short reads, errors, blocking time, latency histograms), shared by copies.
+			// Disabled by default : then I/O routines only pay a test. Should be enabled before the socket is used by several threads.
+		void enable_stats () { if (shd->stats == NULL) shd->stats = new io_stats; }
+		io_stats* get_stats () const { return shd->stats; } // NULL if disabled
+		io_stats_snapshot stats_snapshot () const { return (shd->stats != NULL) ? shd->stats->snapshot() : io_stats_snapshot(); }
+		
+			// I/O deadline : bounds all the following I/O (eg. a whole message, or a request and its response), on any BaseIO.
+			//  Strict, and enforced in userspace with poll() : once passed, reads and writes throw io_error with ETIMEDOUT (see is_timeout_error()).
+			//  Setting or clearing it costs no syscall. Applies with pipe and socket read timeouts. Shared by copies.
+		void set_deadline (timeval from_now) { shd->deadline = _base_fd::_min_deadline(0, from_now); }
+		void clear_deadline ()               { shd->deadline = 0; }
+		bool has_deadline () const           { return shd->deadline != 0; }
+		timeval deadline_left () const; // TIMEOUT_INF if none, {0,0} if passed
+			// Deadline for the life of the object, restoring the previous one at its end
+		class deadline_scope {
+			base_fd& s;
+			const uint64_t prev;
+		public:
+			deadline_scope (base_fd& s, timeval from_now) : s(s), prev(s.shd->deadline) { s.set_deadline(from_now); }
+			~deadline_scope () { s.shd->deadline = prev; }
+			deadline_scope (const deadline_scope&) = delete;
+		};
+		
 			// fcntl()
 /*		#warning TO DO : F_SETOWN/F_GETSIG/F_SETSIG*/
 		class fcntl_fl : public socketxx::flags {
@@ -216,6 +280,8 @@ namespace socketxx {
 		
 			// Data ready to be read
 		bool i_avail ();
+			// Data already pulled from the fd and buffered in userspace by the BaseIO, that select() can't see
+		virtual size_t i_buffered () const { return 0; }
 		
 /*			// Aggregation
 		void cork ()   { }
@@ -225,15 +291,18 @@ namespace socketxx {
 		// Common I/O routines
 	protected:
 			// Write
-		void _o (const void* d, size_t len); // Normal write
+		void _o (const void* d, size_t len); // Normal write. With a deadline, the fd is switched to non-blocking mode (for all copies and processes sharing it)
 		void _o_flags (const void* d, size_t len, int flags) { _o(d, len); } // Not applicable for simple fd, only for sockets !
 		
 			// Read
 		size_t _i (void* d, size_t maxlen); // Normal read : read data's size is not guaranteed (min 1, max maxlen)
-		void _i_fixsize (void* d, size_t len); // Strict read : returns only if [len] data is read; timeout is _not_ strict, it is reset each time data is received
+		void _i_fixsize (void* d, size_t len); // Strict read : returns only if [len] data is read; only the deadline is strict
+			// Switch to non-blocking mode if a deadline is set (writes after a poll() could block past it)
+		void _fd_nonblock ();
 		
-		public: struct _io_fncts { typedef size_t (socketxx::base_fd::* i_fnct) (void *, size_t); typedef void (socketxx::base_fd::* o_fnct) (const void *, size_t); i_fnct i; o_fnct o; };
-		protected: virtual _io_fncts _get_io_fncts () { return _io_fncts({ &base_fd::_i, &base_fd::_o }); }
+			// I/O functions of the BaseIO. `raw` : data goes unmodified and unbuffered to the fd, so it can be moved in kernel (eg. splice())
+		public: struct _io_fncts { typedef size_t (socketxx::base_fd::* i_fnct) (void *, size_t); typedef void (socketxx::base_fd::* o_fnct) (const void *, size_t); i_fnct i; o_fnct o; bool raw; };
+		protected: virtual _io_fncts _get_io_fncts () { return _io_fncts({ &base_fd::_i, &base_fd::_o, true }); }
 		
 	};
 	
@@ -244,10 +313,15 @@ namespace socketxx {
 
 	namespace _base_pipe {
 		extern const std::logic_error badend_w, badend_r;
-		void _pipe_select_wait (fd_t, timeval* tm);
-		size_t _i_pipe (fd_t, void* d, size_t maxlen, timeval tm);
-		void _ifix_pipe (fd_t, void* d, size_t len, timeval tm);
+			// Reads. With `nonblock` (O_NONBLOCK set on the fd), the read is tried first and poll() is only called when the pipe is empty
+		size_t _i_pipe (fd_t, void* d, size_t maxlen, timeval tm, uint64_t deadline, bool nonblock, io_stats* st);
+		void _ifix_pipe (fd_t, void* d, size_t len, timeval tm, uint64_t deadline, bool nonblock, io_stats* st);
 		void _check_pipe (fd_t, rw_t);
+			// Pipe capacity (Linux)
+		size_t _set_pipe_size (fd_t, size_t sz);
+		size_t _get_pipe_size (fd_t);
+			// Write with vmsplice() : pages are given to the pipe without copy
+		void _o_vmsplice (fd_t, const void* d, size_t len, uint64_t deadline, io_stats* st);
 	}
 	template <rw_t rw>
 	class base_pipe : public base_fd {
@@ -264,6 +338,9 @@ namespace socketxx {
 		base_pipe (fd_t handle, bool autoclose_handle) : base_fd(autoclose_handle, handle), timeout(TIMEOUT_INF) { _base_pipe::_check_pipe(handle, rw); }
 			// Copy constuctor
 		base_pipe (const base_pipe<rw>& other) : base_fd(other), timeout(other.timeout) {}
+		base_pipe (base_pipe<rw>&& other) noexcept : base_fd(std::move(other)), timeout(other.timeout) {}
+		base_pipe& operator= (const base_pipe<rw>&) = default;
+		base_pipe& operator= (base_pipe<rw>&&) = default;
 			// Construct from base_fd
 		base_pipe (const base_fd& base) : base_fd(base), timeout(TIMEOUT_INF) { _base_pipe::_check_pipe(this->fd, rw); }
 		
@@ -271,10 +348,26 @@ namespace socketxx {
 		virtual ~base_pipe () {}
 		
 			// Timeout. Modifications dot not spread across copies. Special values : TIMEOUT_INF, TIMEOUT_NOBLOCK
+			//  With a timeout or a deadline, the read end is switched to non-blocking mode (O_NONBLOCK, for all copies and
+			//  processes sharing it) : data is read at once when available, poll() is only called when the pipe is empty.
 		timeval timeout;
 		void set_read_timeout (timeval tm) { this->timeout = tm; }
 		timeval get_read_timeout () const { return timeout; }
 		
+			// Pipe capacity (64KiB by default on Linux) : bigger pipes need less context switches between writer and reader.
+			//  The size is rounded up by the kernel, and limited to /proc/sys/fs/pipe-max-size for unprivileged processes. Returns the new size.
+		size_t set_pipe_size (size_t sz) { return _base_pipe::_set_pipe_size(fd, sz); }
+		size_t get_pipe_size () const    { return _base_pipe::_get_pipe_size(fd); }
+		
+			// Zero-copy write with vmsplice() : pages of the buffer are referenced by the pipe instead of copied. The buffer
+			//  must not be modified nor freed before the reader consumed all the data. Worth it for big buffers (> 64KiB),
+			//  and even more if the reader splice()s the data out. Plain write() if vmsplice() is not available.
+		void o_vmsplice (const void* d, size_t len) {
+			if (rw != rw_t::WRITE) throw _base_pipe::badend_w;
+			this->_fd_nonblock();
+			_base_pipe::_o_vmsplice(fd, d, len, shd->deadline, shd->stats);
+		}
+		
 		// Common I/O routines
 	protected:
 			// Send
@@ -287,14 +380,22 @@ namespace socketxx {
 			// Read
 		size_t _i (void* d, size_t maxlen) {
 			if (rw != rw_t::READ) throw _base_pipe::badend_r;
-			return _base_pipe::_i_pipe(fd, d, maxlen, timeout);
+			this->_pipe_nonblock();
+			return _base_pipe::_i_pipe(fd, d, maxlen, timeout, shd->deadline, shd->nonblock, shd->stats);
 		}
 		void _i_fixsize (void* d, size_t len) { // Strict read : returns only if [len] data is read; timeout _may not_ be strict, it can be reset each time data is received
 			if (rw != rw_t::READ) throw _base_pipe::badend_r;
-			_base_pipe::_ifix_pipe(fd, d, len, timeout);
+			this->_pipe_nonblock();
+			_base_pipe::_ifix_pipe(fd, d, len, timeout, shd->deadline, shd->nonblock, shd->stats);
+		}
+		void _pipe_nonblock () {
+			if (not shd->nonblock and (timeout != TIMEOUT_INF or shd->deadline != 0)) {
+				_base_fd::_set_nonblock(fd);
+				shd->nonblock = true;
+			}
 		}
 		
-		virtual _io_fncts _get_io_fncts () { return _io_fncts({ (_io_fncts::i_fnct)&base_pipe::_i, (_io_fncts::o_fnct)&base_pipe::_o }); }
+		virtual _io_fncts _get_io_fncts () { return _io_fncts({ (_io_fncts::i_fnct)&base_pipe::_i, (_io_fncts::o_fnct)&base_pipe::_o, true }); }
 	};
 	
 		///-------------------------------------------///
@@ -304,8 +405,8 @@ namespace socketxx {
 	protected:
 		
 			// Create a new socket
-		static fd_t create_socket (sa_family_t af);
-		base_socket (sa_family_t af) : base_fd( base_socket::create_socket(af) ) {}
+		static fd_t create_socket (sa_family_t af, int type = SOCK_STREAM);
+		base_socket (sa_family_t af, int type = SOCK_STREAM) : base_fd( base_socket::create_socket(af, type) ) {}
 			// Private initialization
 		void check_socket () const;
 		base_socket (bool autoclose_handle, socket_t handle) : base_fd(autoclose_handle, handle) {}  // Don't forget to check file descriptor
@@ -318,6 +419,9 @@ namespace socketxx {
 		base_socket (socket_t handle, bool autoclose_handle) : base_fd(autoclose_handle, handle) { this->check_socket(); }
 			// Copy constuctor
 		base_socket (const base_socket& other) : base_fd(other) {}
+		base_socket (base_socket&& other) noexcept : base_fd(std::move(other)) {}
+		base_socket& operator= (const base_socket&) = default;
+		base_socket& operator= (base_socket&&) = default;
 			// Construct from base_fd : underlying MUST be a socket
 		base_socket (const base_fd& base) : base_fd(base) { this->check_socket(); }
 		
@@ -335,6 +439,7 @@ namespace socketxx {
 		static size_t _getopt_sock    (socket_t fd, int flag, void* d, size_t s);
 		static int  _getopt_sock_int  (socket_t fd, int flag);
 /*		#warning TO DO (SOL_SOCKET level) : SO_NOSIGPIPE, SO_PRIORITY, SO_OOBINLINE, SO_KEEPALIVE, SO_MARK, SO_BINDTODEVICE ?, SO_RCVBUF, SO_RCVLOWAT+SO_SNDLOWAT (erm, 1 by default, which is right), SO_RCVTIMEO ofc, SO_SNDBUF, SO_TIMESTAMP ?*/
+			// Read timeout (SO_RCVTIMEO), reset on each received data. Cached : setting the same value or getting it costs no syscall.
 		void set_read_timeout (timeval timeout);
 		timeval get_read_timeout () const;
 		
@@ -355,7 +460,12 @@ namespace socketxx {
 		size_t _i (void* d, size_t maxlen);
 		void _i_fixsize (void* d, size_t len); // Returns only if [len] data is read, Use MSG_WAITALL if possible
 		
-		virtual _io_fncts _get_io_fncts () { return _io_fncts({ (_io_fncts::i_fnct)&base_socket::_i, (_io_fncts::o_fnct)&base_socket::_o }); }
+			// With a deadline or a non-blocking fd, calls are made with MSG_DONTWAIT first, and poll() only if they would block
+		bool _wait_mode () const { return shd->deadline != 0 or shd->nonblock; }
+			// Deadline of a wait for received data : I/O deadline, or read timeout from now
+		uint64_t _rcv_deadline () const { return _base_fd::_min_deadline(shd->deadline, this->get_read_timeout()); }
+		
+		virtual _io_fncts _get_io_fncts () { return _io_fncts({ (_io_fncts::i_fnct)&base_socket::_i, (_io_fncts::o_fnct)&base_socket::_o, true }); }
 	};
 	
 }
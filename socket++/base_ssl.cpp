@@ -3,6 +3,11 @@
 	// General headers
 #include <sstream>
 #include <errno.h>
+#include <string.h>
+
+	// OS headers
+#include <fcntl.h>
+#include <poll.h>
 
 #ifdef XIF_USE_SSL
 
@@ -57,10 +62,19 @@ namespace socketxx {
 	
 		/// New SSL socket
 	
-	void base_ssl::new_ssl_socket (const SSL_METHOD* method) {
+	base_ssl::ctx_setup_f base_ssl::ctx_setup = NULL;
+	
+	void base_ssl::new_ssl_socket (const SSL_METHOD* method, bool server_side) {
 		ssl_ctx = SSL_CTX_new(const_cast<SSL_METHOD*>(method));
 		if (ssl_ctx == NULL) 
 			throw socketxx::ssl_error(ssl_error::START);
+		if (ctx_setup != NULL) {
+			try {
+				ctx_setup(ssl_ctx, server_side);
+			} catch (...) {
+				SSL_CTX_free(ssl_ctx); ssl_ctx = NULL; throw;
+			}
+		}
 		ssl_sock = SSL_new(ssl_ctx);
 		if (ssl_sock == NULL) 
 			throw socketxx::ssl_error(ssl_error::START);
@@ -72,59 +86,165 @@ namespace socketxx {
 	
 	void base_ssl::start_ssl () {
 		#warning test if already started
-		this->new_ssl_socket(TLS_client_method());
-		if (SSL_connect(ssl_sock) <= 0) 
-			throw socketxx::ssl_error(ssl_error::START);
+		this->new_ssl_socket(TLS_client_method(), false);
+		if (shd->deadline != 0) this->_ssl_nonblock();
+		int r;
+		while ((r = SSL_connect(ssl_sock)) <= 0) 
+			if (not this->_ssl_wait(r, io_error::READ)) 
+				throw socketxx::ssl_error(ssl_error::START);
 	}
 
 	void base_ssl::wait_for_ssl () {
-		this->new_ssl_socket(TLS_server_method());
-		if (SSL_accept(ssl_sock) <= 0) 
-			throw socketxx::ssl_error(ssl_error::START);
+		this->new_ssl_socket(TLS_server_method(), true);
+		if (shd->deadline != 0) this->_ssl_nonblock();
+		int r;
+		while ((r = SSL_accept(ssl_sock)) <= 0) 
+			if (not this->_ssl_wait(r, io_error::READ)) 
+				throw socketxx::ssl_error(ssl_error::START);
 	}
 
 	void base_ssl::stop_ssl () {
 		if (ssl_sock == NULL) throw std::logic_error("can't stop SSL : SSL not started");
-		if (SSL_shutdown(ssl_sock) <= 0) 
+		this->flush();
+		int r;
+		while ((r = SSL_shutdown(ssl_sock)) < 0 and this->_ssl_wait(r, io_error::WRITE)) ;
+		if (r <= 0) 
 			throw socketxx::ssl_error(ssl_error::STOP);
 		SSL_free(ssl_sock);
 		ssl_sock = NULL;
+		rbuf_beg = rbuf_end = 0;
 		SSL_CTX_free(ssl_ctx);
 		ssl_ctx = NULL;
 	}
 
+		/// Deadlines
+	
+	void base_ssl::_ssl_nonblock () {
+		if (shd->nonblock) return;
+		int fl = ::fcntl(fd, F_GETFL);
+		if (fl == -1 or ::fcntl(fd, F_SETFL, fl|O_NONBLOCK) == -1) 
+			throw socketxx::other_error("base_ssl : can't set non-blocking mode for deadlines");
+		shd->nonblock = true;
+	}
+	
+		// Waits for the socket if a failed SSL call wants to read or write. Returns false if it's a real error.
+	bool base_ssl::_ssl_wait (int ret, io_error::_type t) {
+		if (not shd->nonblock) return false;
+		int e = SSL_get_error(ssl_sock, ret);
+		if (e != SSL_ERROR_WANT_READ and e != SSL_ERROR_WANT_WRITE) return false;
+		ERR_clear_error();
+		uint64_t deadline = (t == io_error::READ) ? this->_rcv_deadline() : shd->deadline;
+		_base_fd::_poll_wait(fd, (e == SSL_ERROR_WANT_READ) ? POLLIN : POLLOUT, deadline, t);
+		return true;
+	}
+	
 		/// Read/Write methods
 	
-	void base_ssl::_o_ssl (const void* d, size_t len) {
-		int ret = SSL_write(ssl_sock, d, (int)len);
+	void base_ssl::_o_ssl_raw (const void* d, size_t len) {
+		if (shd->deadline != 0) this->_ssl_nonblock();
+		_io_stats::timer tm (shd->stats);
+		int ret;
+		try {
+			while ((ret = SSL_write(ssl_sock, d, (int)len)) <= 0 and this->_ssl_wait(ret, io_error::WRITE)) ;
+		} catch (...) { tm.write(-1); throw; }
+		tm.write(ret);
 		if (ret < (int)len) throw socketxx::io_ssl_error(io_error::WRITE, ssl_sock, ret);
 		ERR_clear_error();
 		errno = 0;
 	}
+	
+	void base_ssl::_flush_wbuf () {
+		size_t len = wbuf_len;
+		wbuf_len = 0; // Discard data if the write fails
+		this->_o_ssl_raw(wbuf, len);
+	}
+	
+	void base_ssl::_o_ssl (const void* d, size_t len) {
+		if (not wcoalesce) 
+			return this->_o_ssl_raw(d, len);
+		const char* data = (const char*)d;
+		if (wbuf_len != 0) { // Complete the pending record
+			size_t n = (len < wbuf_sz - wbuf_len) ? len : wbuf_sz - wbuf_len;
+			::memcpy(wbuf+wbuf_len, data, n);
+			wbuf_len += n;
+			data += n;
+			len -= n;
+			if (wbuf_len < wbuf_sz) 
+				return;
+			this->_flush_wbuf();
+		}
+		if (len >= wbuf_sz) { // Full records : no need to buffer
+			this->_o_ssl_raw(data, len);
+		} else if (len != 0) {
+			if (wbuf == NULL) 
+				wbuf = new char[wbuf_sz];
+			::memcpy(wbuf, data, len);
+			wbuf_len = len;
+		}
+	}
 
-	size_t base_ssl::_i_ssl (void* d, size_t maxlen) {
-		int ret = SSL_read(ssl_sock, d, (int)maxlen);
+	size_t base_ssl::_i_ssl_raw (void* d, size_t maxlen) {
+		if (shd->deadline != 0) this->_ssl_nonblock();
+		_io_stats::timer tm (shd->stats);
+		int ret;
+		try {
+			while ((ret = SSL_read(ssl_sock, d, (int)maxlen)) <= 0 and this->_ssl_wait(ret, io_error::READ)) ;
+		} catch (...) { tm.read(-1); throw; }
+		tm.read(ret);
 		if (ret < 1) throw socketxx::io_ssl_error(io_error::READ, ssl_sock, ret);
 		ERR_clear_error();
 		errno = 0;
 		return (size_t)ret;
 	}
+	
+		// Decrypt the next TLS record in the read-ahead buffer. Must be called only when the buffer is empty.
+	void base_ssl::_fill_rbuf () {
+		if (rbuf == NULL) 
+			rbuf = new char[rbuf_sz];
+		rbuf_beg = rbuf_end = 0;
+		rbuf_end = this->_i_ssl_raw(rbuf, rbuf_sz);
+	}
+	
+	size_t base_ssl::_i_ssl (void* d, size_t maxlen) {
+		this->flush();
+		size_t avail = rbuf_end - rbuf_beg;
+		if (avail == 0) {
+			if (maxlen >= rbuf_sz) // Big enough to hold a whole record : no need to buffer
+				return this->_i_ssl_raw(d, maxlen);
+			this->_fill_rbuf();
+			avail = rbuf_end;
+		}
+		if (maxlen > avail) 
+			maxlen = avail;
+		::memcpy(d, rbuf+rbuf_beg, maxlen);
+		rbuf_beg += maxlen;
+		return maxlen;
+	}
 
 	void base_ssl::_i_fixsize_ssl (void* d, size_t len) {
-		size_t r;
+		this->flush();
 		char* data = (char*)d;
-		r = this->_i_ssl(data, len);
-		if (r < len) {
-			size_t rest = len - r;
-			data += r;
-			while (rest != 0) {
-				r = this->_i_ssl(data, len);
+		for (;;) {
+			size_t avail = rbuf_end - rbuf_beg;
+			if (avail >= len) {
+				::memcpy(data, rbuf+rbuf_beg, len);
+				rbuf_beg += len;
+				return;
+			}
+			::memcpy(data, rbuf+rbuf_beg, avail);
+			data += avail;
+			len -= avail;
+			rbuf_beg = rbuf_end = 0;
+			while (len >= rbuf_sz) { // Decrypt big remaining parts directly in the destination
+				size_t r = this->_i_ssl_raw(data, len);
 				data += r;
-				rest -= r;
+				len -= r;
 			}
+			if (len == 0) 
+				return;
+			this->_fill_rbuf();
 		}
 	}
-
 }
 
 #endif
@@ -46,37 +46,76 @@ namespace socketxx {
 		SSL* ssl_sock;
 		SSL_CTX* ssl_ctx;
 		
+			// Read-ahead buffer : whole TLS records are decrypted into it, and small reads are served from it
+		static const size_t rbuf_sz = SSL3_RT_MAX_PLAIN_LENGTH;
+		char* rbuf;
+		size_t rbuf_beg, rbuf_end;
+			// Write-combining buffer : small writes are accumulated to fill full-size records
+		static const size_t wbuf_sz = SSL3_RT_MAX_PLAIN_LENGTH;
+		char* wbuf;
+		size_t wbuf_len;
+		bool wcoalesce;
+		
 			// Create SSL socket on top of `fd` socket
-		void new_ssl_socket (const SSL_METHOD* method);
+		void new_ssl_socket (const SSL_METHOD* method, bool server_side);
 		
 			// Create a new TCP socket
-		base_ssl () : base_netsock(), ssl_sock(NULL), ssl_ctx(NULL) {}
+		base_ssl () : base_netsock(), ssl_sock(NULL), ssl_ctx(NULL), rbuf(NULL), rbuf_beg(0), rbuf_end(0), wbuf(NULL), wbuf_len(0), wcoalesce(false) {}
 			// Private initialization
-		base_ssl (bool autoclose_handle, socket_t handle) : base_netsock(autoclose_handle, handle), ssl_sock(NULL), ssl_ctx(NULL) {}  // Don't forget to check file descriptor
+		base_ssl (bool autoclose_handle, socket_t handle) : base_netsock(autoclose_handle, handle), ssl_sock(NULL), ssl_ctx(NULL), rbuf(NULL), rbuf_beg(0), rbuf_end(0), wbuf(NULL), wbuf_len(0), wcoalesce(false) {}  // Don't forget to check file descriptor
 			// No copy
 		base_ssl (const base_ssl&) = delete;
+		base_ssl& operator= (const base_ssl&) = delete;
+		
+	public:
 		
+			// Context setup hook, called for each new SSL context before the session is created : certificates, keys, ciphers, verification...
+			// Shared by all base_ssl objects. Can throw to abort the session start.
+		typedef void (*ctx_setup_f) (SSL_CTX* ctx, bool server_side);
+		static void set_ctx_setup (ctx_setup_f f) { ctx_setup = f; }
+	private:
+		static ctx_setup_f ctx_setup;
 	public:
 		
 			// Destuctor
-		virtual ~base_ssl () noexcept { REFCXX_WILL_DESTRUCT(base_fd) { if (ssl_sock != NULL) try { this->stop_ssl(); } catch (...) {} } }
+		virtual ~base_ssl () noexcept { if (this->_last_ref()) { if (ssl_sock != NULL) try { this->stop_ssl(); } catch (...) {} } delete[] rbuf; delete[] wbuf; }
 		
 			// Contructor from base_netsock
-		base_ssl (const socketxx::base_netsock& o) : base_netsock(o), ssl_sock(NULL), ssl_ctx(NULL) {}
+		base_ssl (const socketxx::base_netsock& o) : base_netsock(o), ssl_sock(NULL), ssl_ctx(NULL), rbuf(NULL), rbuf_beg(0), rbuf_end(0), wbuf(NULL), wbuf_len(0), wcoalesce(false) {}
+			// Move constructor : the SSL session and buffers are taken from `o`
+		base_ssl (base_ssl&& o) noexcept : base_netsock(std::move(o)), ssl_sock(o.ssl_sock), ssl_ctx(o.ssl_ctx), rbuf(o.rbuf), rbuf_beg(o.rbuf_beg), rbuf_end(o.rbuf_end), wbuf(o.wbuf), wbuf_len(o.wbuf_len), wcoalesce(o.wcoalesce) { o.ssl_sock = NULL; o.ssl_ctx = NULL; o.rbuf = o.wbuf = NULL; o.rbuf_beg = o.rbuf_end = o.wbuf_len = 0; }
 		
 			// SSL connection
 		void wait_for_ssl (); // For the initiator who waits the other side to begin the SSL connection (server side typically)
 		void start_ssl (); // For the side who really begin the SSL connection (client side typically)
 		void stop_ssl (); // For both
 		
+			// Write coalescing : when enabled, written data is accumulated into full-size TLS records.
+			// Pending data is sent when the buffer is full, before any read, on flush(), and when SSL is stopped.
+		void set_write_coalescing (bool enable) { if (not enable) this->flush(); wcoalesce = enable; }
+		void flush () { if (wbuf_len != 0) this->_flush_wbuf(); }
+		
+			// Decrypted data waiting in the read-ahead buffer or in OpenSSL's one
+		virtual size_t i_buffered () const { return (rbuf_end - rbuf_beg) + (ssl_sock == NULL ? 0 : (size_t)SSL_pending(ssl_sock)); }
+		
 			// SSL flags
 /*		#warning TO DO : flags SSL_set_mode() : SSL_MODE_RELEASE_BUFFERS ?, SSL_MODE_AUTO_RETRY*/
 		
 		// Private SSL I/O routines
 	private:
+			// Deadlines : the fd is set in non-blocking mode (SSL_read() may need several reads for one record),
+			//  and SSL calls wanting to read or write are retried after poll()
+		void _ssl_nonblock ();
+		bool _ssl_wait (int ret, io_error::_type t);
 			// SSL_Write()
+		void _o_ssl_raw (const void* d, size_t len);
+		void _flush_wbuf ();
+			// Coalesced writes
 		void _o_ssl (const void* d, size_t len);
 			// SSL_Read()
+		size_t _i_ssl_raw (void* d, size_t maxlen);
+		void _fill_rbuf ();
+			// Buffered reads
 		size_t _i_ssl (void* d, size_t maxlen);
 		void _i_fixsize_ssl (void* d, size_t len);
 		
@@ -90,7 +129,7 @@ namespace socketxx {
 		size_t _i (void* d, size_t maxlen) { if (ssl_sock == NULL) return base_socket::_i(d, maxlen); else return _i_ssl(d, maxlen); }
 		void _i_fixsize (void* d, size_t len) { if (ssl_sock == NULL) base_socket::_i_fixsize(d, len); else _i_fixsize_ssl(d, len); }
 		
-		virtual _io_fncts _get_io_fncts () { return _io_fncts({ (_io_fncts::i_fnct)&base_ssl::_i, (_io_fncts::o_fnct)&base_ssl::_o }); }
+		virtual _io_fncts _get_io_fncts () { return _io_fncts({ (_io_fncts::i_fnct)&base_ssl::_i, (_io_fncts::o_fnct)&base_ssl::_o, false }); }
 	};
 	
 }
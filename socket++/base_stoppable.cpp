@@ -0,0 +1,102 @@
+#include <socket++/base_stoppable.hpp>
+
+	// OS headers
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#ifdef HAVE_EVENTFD
+	#include <sys/eventfd.h>
+#endif
+
+namespace socketxx {
+
+	/************* BaseStoppable Implementation *************/
+
+	namespace _base_stoppable {
+
+		void _wait (fd_t fd, const fd_t* stop, size_t n, uint64_t deadline) {
+			pollfd small[4];
+			std::vector<pollfd> big;
+			pollfd* p = small;
+			if (n+1 > 4) {
+				big.resize(n+1);
+				p = big.data();
+			}
+			p[0] = { fd, POLLIN, 0 };
+			for (size_t i = 0; i < n; i++)
+				p[i+1] = { stop[i], POLLIN, 0 };
+			for (;;) {
+				int ms = -1;
+				bool last = false;
+				if (deadline != 0) {
+					uint64_t now = _io_stats::now_ns();
+					if (now >= deadline) {
+						ms = 0;
+						last = true;
+					} else {
+						uint64_t left = (deadline - now + 999999) / 1000000;
+						ms = (left > INT_MAX) ? INT_MAX : (int)left;
+					}
+				}
+				int r = ::poll(p, (nfds_t)(n+1), ms);
+				if (r == -1) {
+					if (errno == EINTR) continue;
+					throw socketxx::io_error(-1, io_error::READ);
+				}
+				for (size_t i = 0; i < n; i++)
+					if (p[i+1].revents != 0)
+						throw socketxx::stop_event(stop[i]);
+				if (p[0].revents != 0)
+					return; // Including errors and hang-ups, reported by the following read
+				if (last) {
+					errno = ETIMEDOUT;
+					throw socketxx::io_error(-1, io_error::READ);
+				}
+			}
+		}
+
+	}
+
+	/************* Stop notifier Implementation *************/
+
+	stop_notifier::stop_notifier () {
+	#ifdef HAVE_EVENTFD
+		rfd = wfd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (rfd == -1)
+			throw socketxx::other_error("Failed to create eventfd");
+	#else
+		fd_t p[2];
+		if (::pipe(p) == -1)
+			throw socketxx::other_error("Failed to create pipe");
+		for (fd_t f : p) {
+			::fcntl(f, F_SETFD, FD_CLOEXEC);
+			::fcntl(f, F_SETFL, ::fcntl(f, F_GETFL) | O_NONBLOCK);
+		}
+		rfd = p[0]; wfd = p[1];
+	#endif
+	}
+
+	stop_notifier::~stop_notifier () noexcept {
+		::close(rfd);
+		if (wfd != rfd) ::close(wfd);
+	}
+
+	void stop_notifier::notify () noexcept {
+	#ifdef HAVE_EVENTFD
+		uint64_t one = 1;
+		ssize_t r = ::write(wfd, &one, sizeof(one));
+	#else
+		char c = 0;
+		ssize_t r = ::write(wfd, &c, 1); // Pipe full : already notified
+	#endif
+		(void)r;
+	}
+
+	void stop_notifier::reset () noexcept {
+		char buf[64];
+		while (::read(rfd, buf, sizeof(buf)) > 0) {}
+	}
+
+}
@@ -0,0 +1,107 @@
+#ifndef SOCKET_XX_BASE_STOPPABLE_H
+#define SOCKET_XX_BASE_STOPPABLE_H
+
+	// BaseIO
+#include <socket++/base_io.hpp>
+
+	// General headers
+#include <vector>
+#include <type_traits>
+#include <algorithm>
+
+namespace socketxx {
+
+		// Private external functions
+	namespace _base_stoppable {
+			// Wait until `fd` is readable, or throw stop_event if one of the `n` stop fds is (stop fds have priority).
+			//  Until `deadline` (0 : none), then throws io_error with ETIMEDOUT as base_fd's deadlines.
+		void _wait (fd_t fd, const fd_t* stop, size_t n, uint64_t deadline);
+	}
+
+	/***** Stop notifier *****
+	 *
+	 *  File descriptor to monitor as stop fd : an eventfd on Linux, a pipe otherwise.
+	 *  Once notified, it stays readable until reset() : every thread waiting on it is stopped.
+	 *  notify() is thread-safe and async-signal-safe (can be called from a SIGTERM handler).
+	 */
+	class stop_notifier {
+		fd_t rfd, wfd;
+	public:
+		stop_notifier ();
+		stop_notifier (const stop_notifier&) = delete;
+		stop_notifier& operator= (const stop_notifier&) = delete;
+		~stop_notifier () noexcept;
+		fd_t get_fd () const { return rfd; }
+		void notify () noexcept;
+		void reset () noexcept;
+	};
+
+		///------ Stoppable BaseIO ------///
+	/*
+	 *  Read filter on top of any BaseIO : before waiting for data, reads poll() the fd together with "stop" fds
+	 *   (eventfd, pipe, stdin...), and throw a stop_event if one of them is readable. Used with an IO protocol,
+	 *   eg. simple_socket<base_stoppable<base_netsock>> (stoppable_simple_socket in quickdefs.h), worker threads blocked in
+	 *   i_* methods can be woken for shutdown or other work, without closing the socket.
+	 *  Data already buffered by the BaseIO (TLS, compression...) is read without polling. Stop fds are checked only
+	 *   before the first byte of each read : a fixed-size read is never cut in the middle. A stop between two reads
+	 *   of a same message (eg. a string and its length) leaves the stream inside the message : stops are meant for
+	 *   waiting threads, between messages.
+	 *  The socket's read timeout and the I/O deadline apply to the wait (only the deadline for other fds).
+	 *  Stop fds are not closed, and are not shared with copies. Writes are not affected. File receptions read through
+	 *   the stoppable routines (no splice()).
+	 */
+	template <typename io_base>
+	class base_stoppable : public io_base {
+	protected:
+
+			// Monitored fds
+		std::vector<fd_t> stop_fds;
+
+			// Private initialization
+		base_stoppable (bool autoclose_handle, socket_t handle) : io_base(autoclose_handle, handle) {}
+		base_stoppable () : io_base() {}
+
+			// Wait for data, or throw stop_event
+		uint64_t _wait_deadline (std::true_type) const  { return this->_rcv_deadline(); }
+		uint64_t _wait_deadline (std::false_type) const { return this->shd->deadline; }
+		void _wait () {
+			if (not stop_fds.empty() and this->i_buffered() == 0)
+				_base_stoppable::_wait(this->fd, stop_fds.data(), stop_fds.size(), this->_wait_deadline(std::is_base_of<socketxx::base_socket, io_base>()));
+		}
+
+	public:
+
+			// Construct from an io_base object, with a first stop fd
+		base_stoppable (const io_base& o) : io_base(o) {}
+		base_stoppable (const io_base& o, fd_t stop_fd) : io_base(o), stop_fds(1, stop_fd) {}
+			// Copy and move
+		base_stoppable (const base_stoppable& o) : io_base(o), stop_fds(o.stop_fds) {}
+		base_stoppable (base_stoppable&& o) noexcept : io_base(std::move(o)), stop_fds(std::move(o.stop_fds)) {}
+		base_stoppable& operator= (const base_stoppable&) = default;
+		base_stoppable& operator= (base_stoppable&&) = default;
+
+			// Stop fds. Modifications do not spread across copies.
+		void add_stop_fd (fd_t fd)    { stop_fds.push_back(fd); }
+		void remove_stop_fd (fd_t fd) { stop_fds.erase(std::remove(stop_fds.begin(), stop_fds.end(), fd), stop_fds.end()); }
+		void clear_stop_fds ()        { stop_fds.clear(); }
+		const std::vector<fd_t>& get_stop_fds () const { return stop_fds; }
+
+		// Common I/O routines
+	protected:
+			// Read
+		size_t _i (void* d, size_t maxlen) { this->_wait(); return io_base::_i(d, maxlen); }
+		void _i_fixsize (void* d, size_t len) {
+			if (stop_fds.empty()) { io_base::_i_fixsize(d, len); return; }
+			this->_wait();
+			size_t r = io_base::_i(d, len);
+			if (r < len)
+				io_base::_i_fixsize((char*)d + r, len - r);
+		}
+
+			// Not raw : data moved in kernel (eg. splice() by file transfers) would bypass the stop fds
+		virtual base_fd::_io_fncts _get_io_fncts () { return base_fd::_io_fncts({ (base_fd::_io_fncts::i_fnct)&base_stoppable::_i, this->io_base::_get_io_fncts().o, false }); }
+	};
+
+}
+
+#endif
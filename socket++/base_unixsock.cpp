@@ -2,6 +2,8 @@
 
 	// OS headers
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 
 	// General headers
 #include <string.h>
@@ -32,7 +34,21 @@ namespace socketxx {
 		return std::pair<base_unixsock,base_unixsock>( base_unixsock(true,p[0]), base_unixsock(true,p[1]) );
 	}
 	
+#ifdef __linux__
+	base_unixsock::addr_info base_unixsock::addr_info::abstract (const std::string& name) {
+		sockaddr_un addr;
+		::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (name.size() >= sizeof(addr.sun_path))
+			throw socketxx::error("Name is too long for abstract UNIX socket !");
+		::memcpy(addr.sun_path+1, name.data(), name.size());
+		return addr_info(_addrt({ addr, (socklen_t)(offsetof(sockaddr_un,sun_path)+1+name.size()) }));
+	}
+#endif
+	
 	void base_unixsock::autodel_sock_file (sockaddr_un& addr) {
+		if (addr.sun_path[0] == '\0') // Abstract : no file
+			return;
 		autodel_path = new char[::strlen(addr.sun_path)+1];
 		::strcpy(autodel_path, addr.sun_path);
 	}
@@ -46,8 +62,129 @@ namespace socketxx {
 		}
 	}
 	
+		// File descriptor passing
+	void base_unixsock::_o_fds_msg (const fd_t* fds, size_t n, bool more) {
+		uint32_t hdr = (uint32_t)n | (more ? _base_unixsock::fds_more : 0);
+		union { cmsghdr h; char b[CMSG_SPACE(sizeof(int)*_base_unixsock::max_fds_msg)]; } ctl;
+		iovec iov = { &hdr, sizeof(hdr) };
+		msghdr m;
+		::memset(&m, 0, sizeof(m));
+		m.msg_iov = &iov;
+		m.msg_iovlen = 1;
+		if (n != 0) {
+			m.msg_control = ctl.b;
+			m.msg_controllen = CMSG_SPACE(sizeof(int)*n);
+			cmsghdr* c = CMSG_FIRSTHDR(&m);
+			c->cmsg_level = SOL_SOCKET;
+			c->cmsg_type = SCM_RIGHTS;
+			c->cmsg_len = CMSG_LEN(sizeof(int)*n);
+			::memcpy(CMSG_DATA(c), fds, sizeof(int)*n);
+		}
+		_io_stats::timer tm (shd->stats);
+		bool wait = this->_wait_mode();
+		int flags = MSG_NOSIGNAL | (wait ? MSG_DONTWAIT : 0);
+		ssize_t r;
+		while ((r = ::sendmsg(fd, &m, flags)) == -1) {
+			if (errno == EINTR) continue;
+			if (not wait or (errno != EAGAIN and errno != EWOULDBLOCK)) break;
+			try {
+				_base_fd::_poll_wait(fd, POLLOUT, shd->deadline, io_error::WRITE);
+			} catch (...) { tm.write(-1); throw; }
+		}
+		tm.write(r);
+		if (r < 1) throw socketxx::io_error(r, io_error::WRITE);
+		if ((size_t)r < sizeof(hdr)) // The fds went with the first byte
+			base_socket::_o_flags((const char*)&hdr + r, sizeof(hdr) - (size_t)r, 0);
+	}
+	
+	bool base_unixsock::_i_fds_msg (std::vector<fd_t>& fds) {
+#ifdef MSG_CMSG_CLOEXEC
+		const int cloexec = MSG_CMSG_CLOEXEC;
+#else
+		const int cloexec = 0;
+#endif
+#ifdef MSG_WAITALL
+		const int waitall = MSG_WAITALL;
+#else
+		const int waitall = 0;
+#endif
+		uint32_t hdr;
+		char* p = (char*)&hdr;
+		size_t left = sizeof(hdr), first = fds.size();
+		union { cmsghdr h; char b[CMSG_SPACE(sizeof(int)*_base_unixsock::max_fds_msg)]; } ctl;
+		_io_stats::timer tm (shd->stats);
+		bool wait = this->_wait_mode();
+		int flags = MSG_NOSIGNAL | cloexec | (wait ? MSG_DONTWAIT : waitall);
+		while (left != 0) {
+			iovec iov = { p, left };
+			msghdr m;
+			::memset(&m, 0, sizeof(m));
+			m.msg_iov = &iov;
+			m.msg_iovlen = 1;
+			m.msg_control = ctl.b;
+			m.msg_controllen = sizeof(ctl.b);
+			ssize_t r = ::recvmsg(fd, &m, flags);
+			if (r == -1 and errno == EINTR) continue;
+			if (r == -1 and wait and (errno == EAGAIN or errno == EWOULDBLOCK)) {
+				try {
+					_base_fd::_poll_wait(fd, POLLIN, this->_rcv_deadline(), io_error::READ);
+				} catch (...) { tm.read(-1); throw; }
+				continue;
+			}
+			tm.read(r);
+			if (r < 1) throw socketxx::io_error(r, io_error::READ);
+			for (cmsghdr* c = CMSG_FIRSTHDR(&m); c != NULL; c = CMSG_NXTHDR(&m, c)) {
+				if (c->cmsg_level != SOL_SOCKET or c->cmsg_type != SCM_RIGHTS) continue;
+				size_t k = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+				const char* d = (const char*)CMSG_DATA(c);
+				for (size_t i = 0; i < k; i++) {
+					int f;
+					::memcpy(&f, d + i*sizeof(int), sizeof(int));
+					if (cloexec == 0) ::fcntl(f, F_SETFD, FD_CLOEXEC);
+					fds.push_back(f);
+				}
+			}
+			if (m.msg_flags & MSG_CTRUNC)
+				throw socketxx::error("File descriptors passing : ancillary data truncated");
+			p += r;
+			left -= (size_t)r;
+		}
+		if (fds.size() - first != (hdr & ~_base_unixsock::fds_more))
+			throw socketxx::error("File descriptors passing : received fds do not match the message");
+		return (hdr & _base_unixsock::fds_more) != 0;
+	}
+	
+	void base_unixsock::o_fds (const fd_t* fds, size_t n) {
+		do {
+			size_t k = (n > _base_unixsock::max_fds_msg) ? _base_unixsock::max_fds_msg : n;
+			this->_o_fds_msg(fds, k, n != k);
+			fds += k;
+			n -= k;
+		} while (n != 0);
+	}
+	
+	std::vector<fd_t> base_unixsock::i_fds () {
+		std::vector<fd_t> fds;
+		try {
+			while (this->_i_fds_msg(fds)) ;
+		} catch (...) {
+			for (fd_t f : fds) ::close(f);
+			throw;
+		}
+		return fds;
+	}
+	
+	fd_t base_unixsock::i_fd () {
+		std::vector<fd_t> fds = this->i_fds();
+		if (fds.size() != 1) {
+			for (fd_t f : fds) ::close(f);
+			throw socketxx::error("File descriptors passing : expected one fd");
+		}
+		return fds[0];
+	}
+	
 	base_unixsock::~base_unixsock () noexcept {
-		REFCXX_WILL_DESTRUCT(base_fd) {
+		if (this->_last_ref()) {
 			base_socket::fd_close();
 			if (autodel_path != NULL) {
 				::unlink(autodel_path);
@@ -56,4 +193,93 @@ namespace socketxx {
 		}
 	}
 	
+	/************* BaseUnixSeqpacket Implementation *************/
+	
+	base_unixseq::base_unixseq (const socketxx::base_socket& o) : base_unixsock(o) {
+		if (base_socket::_getopt_sock_int(fd, SO_TYPE) != SOCK_SEQPACKET)
+			throw socketxx::error("base_unixseq : underlying socket is not a SOCK_SEQPACKET socket");
+	}
+	
+	std::pair<base_unixseq,base_unixseq> base_unixseq::create_socket_pair () {
+		socket_t p[2];
+		if (::socketpair((sa_family_t)AF_UNIX, SOCK_SEQPACKET, 0, p) == -1)
+			throw socketxx::other_error("Failed to create socket pair");
+		return std::pair<base_unixseq,base_unixseq>( base_unixseq(true,p[0]), base_unixseq(true,p[1]) );
+	}
+	
+		// Receive one packet
+	size_t base_unixseq::_recv_pkt (void* d, size_t maxlen) {
+		iovec iov = { d, maxlen };
+		msghdr m;
+		::memset(&m, 0, sizeof(m));
+		m.msg_iov = &iov;
+		m.msg_iovlen = 1;
+		ssize_t r;
+		_io_stats::timer tm (shd->stats);
+		bool wait = this->_wait_mode();
+		int flags = MSG_NOSIGNAL | (wait ? MSG_DONTWAIT : 0);
+		while ((r = ::recvmsg(fd, &m, flags)) == -1) {
+			if (errno == EINTR) continue;
+			if (not wait or (errno != EAGAIN and errno != EWOULDBLOCK)) break;
+			try {
+				_base_fd::_poll_wait(fd, POLLIN, this->_rcv_deadline(), io_error::READ);
+			} catch (...) { tm.read(-1); throw; }
+		}
+		tm.read(r);
+		if (r < 1) throw socketxx::io_error(r, io_error::READ);
+		if (m.msg_flags & MSG_TRUNC)
+			throw socketxx::error("base_unixseq : received packet bigger than the buffer");
+		return (size_t)r;
+	}
+	
+	size_t base_unixseq::i_pkt (void* d, size_t maxlen) {
+		_base_unixseq::rbuf& b = *rb.b;
+		if (b.beg == b.end)
+			return this->_recv_pkt(d, maxlen);
+		size_t n = b.end - b.beg;
+		if (n > maxlen)
+			throw socketxx::error("base_unixseq : received packet bigger than the buffer");
+		::memcpy(d, b.p + b.beg, n);
+		b.beg = b.end = 0;
+		return n;
+	}
+	
+		// Stream routines : written as packets of at most the max packet size, read from whole packets
+	void base_unixseq::_o (const void* d, size_t len) {
+		this->_o_flags(d, len, 0);
+	}
+	void base_unixseq::_o_flags (const void* d, size_t len, int flags) {
+		const char* data = (const char*)d;
+		size_t cap = rb->cap;
+		while (len != 0) {
+			size_t n = (len < cap) ? len : cap;
+			base_socket::_o_flags(data, n, flags);
+			data += n;
+			len -= n;
+		}
+	}
+	size_t base_unixseq::_i (void* d, size_t maxlen) {
+		_base_unixseq::rbuf& b = *rb.b;
+		if (b.beg == b.end) {
+			if (maxlen >= b.cap) // Whole packet fits
+				return this->_recv_pkt(d, maxlen);
+			if (b.p == NULL)
+				b.p = new char[b.cap];
+			b.end = this->_recv_pkt(b.p, b.cap);
+			b.beg = 0;
+		}
+		size_t n = (maxlen < b.end - b.beg) ? maxlen : b.end - b.beg;
+		::memcpy(d, b.p + b.beg, n);
+		b.beg += n;
+		return n;
+	}
+	void base_unixseq::_i_fixsize (void* d, size_t len) {
+		char* data = (char*)d;
+		while (len != 0) {
+			size_t r = this->_i(data, len);
+			data += r;
+			len -= r;
+		}
+	}
+	
 }
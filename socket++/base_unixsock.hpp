@@ -6,12 +6,22 @@
 
 	// OS headers
 #include <sys/un.h>
+#include <stddef.h>
 
 	// General headers
 #include <utility>
+#include <vector>
 
 namespace socketxx {
 	
+		// Private tools
+	namespace _base_unixsock {
+			// File descriptors per message. Linux's SCM_MAX_FD.
+		const size_t max_fds_msg = 253;
+			// Header flag : the batch continues in the next message
+		const uint32_t fds_more = (uint32_t)1 << 31;
+	}
+	
 		///------ Base class for internet UNIX sockets ------///
 	class base_unixsock : public base_socket {
 	public:
@@ -22,8 +32,10 @@ namespace socketxx {
 		
 	protected:
 		
-			// Create a new TCP socket
+			// Create a new stream socket
 		base_unixsock () : base_socket((sa_family_t)AF_UNIX) {}
+			// Create a new socket of another type (SOCK_SEQPACKET...)
+		explicit base_unixsock (int type) : base_socket((sa_family_t)AF_UNIX, type) {}
 			// Private initialization
 		base_unixsock (bool autoclose_handle, socket_t handle) : base_socket(autoclose_handle, handle) {}  // Don't forget to check file descriptor
 		
@@ -31,18 +43,41 @@ namespace socketxx {
 		
 			// Contructor from base_socket - underlying socket must have AF_UNIX family
 		base_unixsock (const socketxx::base_socket& o) : base_socket(o) {}
+			// Copy and move. The socket file to delete follows the moved object.
+		base_unixsock (const base_unixsock&) = default;
+		base_unixsock (base_unixsock&& o) noexcept : base_socket(std::move(o)), autodel_path(o.autodel_path) { o.autodel_path = NULL; }
+		base_unixsock& operator= (const base_unixsock&) = default;
+		base_unixsock& operator= (base_unixsock&&) = default;
 		
 			// Destuctor
 		virtual ~base_unixsock () noexcept;
 		
+			// File descriptor passing (SCM_RIGHTS) : the fds are duplicated in the receiving process, even unrelated.
+			//  An acceptor process can hand its accepted connections to worker processes.
+			//  Each message is a 4-byte header carrying up to `max_fds_msg` fds; larger batches are split over several messages,
+			//  received at once by i_fds(). Must be read without read-ahead (eg. not through base_compressed).
+			//  Received fds are close-on-exec and owned by the receiver. Sent fds stay open in the sender.
+		void o_fds (const fd_t* fds, size_t n);
+		void o_fds (const std::vector<fd_t>& fds) { this->o_fds(fds.data(), fds.size()); }
+		std::vector<fd_t> i_fds ();
+		void o_fd (fd_t fd) { this->o_fds(&fd, 1); }
+		fd_t i_fd (); // Throws if the message does not carry exactly one fd
+			// Socket passing : `sock` is preserved (no shutdown() when closed here), so the receiver keeps the connection
+		void o_sock (socketxx::base_fd& sock) { sock.set_preserved(); this->o_fd(sock.get_fd()); }
+		socketxx::base_fd i_sock () { return socketxx::base_fd(this->i_fd(), SOCKETXX_AUTO_CLOSE); }
+		
 			// Opts
-/*		#warning TO DO : SCM_RIGHTS, SCM_CREDENTIALS, SO_PASSCRED */
+/*		#warning TO DO : SCM_CREDENTIALS, SO_PASSCRED */
 		
 			// Info struct
 	protected: 
 		
 		char* autodel_path = NULL;
 		void autodel_sock_file (sockaddr_un& addr);
+		
+			// One message of fd passing. Received fds are appended to `fds`.
+		void _o_fds_msg (const fd_t* fds, size_t n, bool more);
+		bool _i_fds_msg (std::vector<fd_t>& fds); // Returns true if the batch continues
 		void del_sock_file ();
 		
 		struct _addrt { 
@@ -69,8 +104,14 @@ namespace socketxx {
 			addr_info& operator= (const addr_info& o) { this->~addr_info(); new(this) addr_info(o); return *this; }
 				// Create addr struct. With server-side, will create a new socket file if don't exists (or throw an EINVAL if exists)
 			addr_info (const char* path);
-				// Getters
+#ifdef __linux__
+				// Linux abstract namespace : no socket file to look up or to delete, the name is released with the last socket.
+				//  `name` can contain any byte.
+			static addr_info abstract (const std::string& name);
+#endif
+				// Getters. The path of an abstract address begins with a null byte.
 			std::string get_path () const { return std::string(addr.sun_path, sizeof(addr.sun_path)-(sizeof(sockaddr_un)-addrlen)); }
+			bool is_abstract () const { return addrlen > offsetof(sockaddr_un,sun_path) and addr.sun_path[0] == '\0'; }
 		};
 		
 	public:
@@ -79,6 +120,83 @@ namespace socketxx {
 		static std::pair<base_unixsock,base_unixsock> create_socket_pair ();
 	};
 	
+		// Private tools
+	namespace _base_unixseq {
+			// Read buffer of stream routines, shared by copies
+		struct rbuf {
+			char* p;     // Allocated at first use
+			size_t cap;  // Max packet size
+			size_t beg, end;
+		};
+		struct rbuf_ref : public refcountxx_base {
+			rbuf* b;
+			rbuf_ref () : b(new rbuf({NULL, 65536, 0, 0})) {}
+			rbuf_ref (const rbuf_ref& o) : refcountxx_base(o), b(o.b) {}
+			~rbuf_ref () { if (this->can_destruct()) { delete[] b->p; delete b; } }
+			rbuf* operator-> () const { return b; }
+		};
+	}
+	
+		///------ Base class for UNIX sequenced-packet sockets ------///
+	/*
+	 *  SOCK_SEQPACKET : connection-oriented and reliable like stream sockets, but message boundaries are kept by the kernel.
+	 *  o_pkt() sends a packet, i_pkt() receives exactly one : no length prefix is needed.
+	 *  Stream routines also work (eg. with simple_socket) : each write is sent as packets of at most the max packet
+	 *   size (64KiB by default), and reads are served from whole packets, buffered and shared by copies.
+	 *  Limits : the max packet size of the reader must not be smaller than the one of the writer. A packet bigger than
+	 *   it (eg. sent with o_pkt()) can only be received by reads asking for at least its size, other reads throw and the
+	 *   packet is lost. The kernel refuses packets bigger than the send buffer (SO_SNDBUF, ~200KiB on Linux) with EMSGSIZE.
+	 *  Servers, clients, addresses and fd passing are the ones of base_unixsock.
+	 */
+	class base_unixseq : public base_unixsock {
+	protected:
+		
+			// Stream routines read buffer
+		_base_unixseq::rbuf_ref rb;
+		
+			// Create a new seqpacket socket
+		base_unixseq () : base_unixsock((int)SOCK_SEQPACKET) {}
+			// Private initialization
+		base_unixseq (bool autoclose_handle, socket_t handle) : base_unixsock(autoclose_handle, handle) {}  // Don't forget to check file descriptor
+		
+	public:
+		
+			// Contructor from base_socket - underlying socket must be an AF_UNIX SOCK_SEQPACKET socket
+		base_unixseq (const socketxx::base_socket& o);
+			// Copy and move
+		base_unixseq (const base_unixseq& o) : base_unixsock(o), rb(o.rb) {}
+		base_unixseq (base_unixseq&& o) noexcept : base_unixsock(std::move(o)), rb(o.rb) {}
+		base_unixseq& operator= (const base_unixseq&) = delete;
+		
+			// Destuctor
+		virtual ~base_unixseq () noexcept {}
+		
+			// Packets. Throws if a received packet is bigger than `maxlen` (the packet is lost), and on the end of connection.
+		void o_pkt (const void* d, size_t len) { base_socket::_o_flags(d, len, 0); }
+		size_t i_pkt (void* d, size_t maxlen); // The rest of a packet partly read by stream routines counts as a packet
+		
+			// Max packet size for stream routines, for reads and writes. Shared by copies.
+		void set_max_packet (size_t sz) { rb->cap = sz; delete[] rb->p; rb->p = NULL; rb->beg = rb->end = 0; }
+		size_t get_max_packet () const  { return rb->cap; }
+		
+			// Data of the current packet not read yet
+		virtual size_t i_buffered () const { return rb->end - rb->beg; }
+		
+			// Create unamed socket pair
+		static std::pair<base_unixseq,base_unixseq> create_socket_pair ();
+		
+		// Common I/O routines
+	protected:
+		size_t _recv_pkt (void* d, size_t maxlen);
+		void _o (const void* d, size_t len);
+		void _o_flags (const void* d, size_t len, int flags);
+		size_t _i (void* d, size_t maxlen);
+		void _i_fixsize (void* d, size_t len);
+		
+			// Buffered : data can't be moved in kernel
+		virtual _io_fncts _get_io_fncts () { return _io_fncts({ (_io_fncts::i_fnct)&base_unixseq::_i, (_io_fncts::o_fnct)&base_unixseq::_o, false }); }
+	};
+	
 }
 
 #endif
@@ -0,0 +1,75 @@
+#include <socket++/bdata_pool.hpp>
+
+namespace socketxx {
+	
+	/************* Binary data pool Implementation *************/
+	
+	bdata_pool::bdata_pool (size_t max_per_class) : max_per_class(max_per_class) {
+#ifndef XIF_NO_THREADS
+		::pthread_mutex_init(&mutex, NULL);
+#endif
+		for (unsigned c = 0; c < n_classes; c++) 
+			free_bufs[c].reserve(max_per_class);
+	}
+	
+	bdata_pool::~bdata_pool () {
+		this->clear();
+#ifndef XIF_NO_THREADS
+		::pthread_mutex_destroy(&mutex);
+#endif
+	}
+	
+		/// Smallest power-of-two class that can hold `len` bytes
+	int bdata_pool::size_class (size_t len) {
+		if (len > ((size_t)1 << class_max_log2)) 
+			return -1;
+		unsigned l = class_min_log2;
+		while (((size_t)1 << l) < len) 
+			l++;
+		return (int)(l - class_min_log2);
+	}
+	
+	void* bdata_pool::alloc (size_t len) {
+		int c = size_class(len);
+		if (c == -1) 
+			return new unsigned char[len];
+		{
+#ifndef XIF_NO_THREADS
+			_mutex_lock l (mutex);
+#endif
+			if (not free_bufs[c].empty()) {
+				void* p = free_bufs[c].back();
+				free_bufs[c].pop_back();
+				return p;
+			}
+		}
+		return new unsigned char[(size_t)1 << (c + class_min_log2)];
+	}
+	
+	void bdata_pool::free (void* p, size_t len) {
+		if (p == NULL) return;
+		int c = size_class(len);
+		if (c != -1) {
+#ifndef XIF_NO_THREADS
+			_mutex_lock l (mutex);
+#endif
+			if (free_bufs[c].size() < max_per_class) {
+				free_bufs[c].push_back(p);
+				return;
+			}
+		}
+		delete[] (unsigned char*)p;
+	}
+	
+	void bdata_pool::clear () {
+#ifndef XIF_NO_THREADS
+		_mutex_lock l (mutex);
+#endif
+		for (unsigned c = 0; c < n_classes; c++) {
+			for (void* p : free_bufs[c]) 
+				delete[] (unsigned char*)p;
+			free_bufs[c].clear();
+		}
+	}
+	
+}
@@ -0,0 +1,51 @@
+#ifndef SOCKET_XX_BDATA_POOL_H
+#define SOCKET_XX_BDATA_POOL_H
+
+	// Defs
+#include <socket++/defs.hpp>
+
+	// General headers
+#include <vector>
+
+	// Threads
+#ifndef XIF_NO_THREADS
+	#include <pthread.h>
+#endif
+
+namespace socketxx {
+	
+	/***** Binary data buffer pool *****
+	 *
+	 *  bdata_allocator recycling freed buffers, by power-of-two size classes from 64B to 1MiB.
+	 *  Bigger buffers are allocated and freed directly with new[]/delete[].
+	 *  At most `max_per_class` free buffers are kept per class, the others are deleted.
+	 *  Thread-safe (unless XIF_NO_THREADS). The pool must outlive all buffers allocated with it.
+	 *  Usage : simple_socket::set_bin_allocator(&pool), then i_bin() returns pooled auto_bdata.
+	 */
+	class bdata_pool : public bdata_allocator {
+	public:
+		static const unsigned class_min_log2 = 6;
+		static const unsigned class_max_log2 = 20;
+	private:
+		static const unsigned n_classes = class_max_log2 - class_min_log2 + 1;
+		std::vector<void*> free_bufs[n_classes];
+		size_t max_per_class;
+#ifndef XIF_NO_THREADS
+		pthread_mutex_t mutex;
+		struct _mutex_lock { pthread_mutex_t* const _m; _mutex_lock (pthread_mutex_t& m) : _m(&m) { ::pthread_mutex_lock(_m); } ~_mutex_lock () { ::pthread_mutex_unlock(_m); } };
+#endif
+		static int size_class (size_t len); // -1 if too big
+	public:
+		bdata_pool (size_t max_per_class = 32);
+		bdata_pool (const bdata_pool&) = delete;
+		bdata_pool& operator= (const bdata_pool&) = delete;
+		virtual ~bdata_pool ();
+		
+		virtual void* alloc (size_t len);
+		virtual void free (void* p, size_t len);
+		void clear (); // Delete all cached free buffers
+	};
+	
+}
+
+#endif
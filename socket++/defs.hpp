@@ -52,14 +52,24 @@ namespace socketxx {
 
 	/** ------ Helpers ------ **/
 	
-		// Autodelete binary data buffer
+		// Allocator for binary data buffers (eg. socketxx::bdata_pool)
+	class bdata_allocator {
+	public:
+		virtual void* alloc (size_t len) = 0;
+		virtual void free (void* p, size_t len) = 0; // `len` is the size given to alloc()
+		virtual ~bdata_allocator () {}
+	};
+	
+		// Autodelete binary data buffer. Freed with delete[], or with its allocator if not NULL (which must outlive the buffer)
 	struct auto_bdata : public refcountxx_base {
 		void* p;
 		size_t len;
-		auto_bdata () : p(NULL), len(0) {}
-		auto_bdata (void* p) : p(p) {}
-		auto_bdata (const auto_bdata& o) : refcountxx_base(o), p(o.p), len(o.len) {}
-		~auto_bdata() { if (this->can_destruct() and p != NULL) { delete[] (unsigned char*)p; } }
+		bdata_allocator* alloc;
+		auto_bdata () : p(NULL), len(0), alloc(NULL) {}
+		auto_bdata (void* p) : p(p), len(0), alloc(NULL) {}
+		auto_bdata (void* p, size_t len, bdata_allocator* alloc) : p(p), len(len), alloc(alloc) {}
+		auto_bdata (const auto_bdata& o) : refcountxx_base(o), p(o.p), len(o.len), alloc(o.alloc) {}
+		~auto_bdata() { if (this->can_destruct() and p != NULL) { if (alloc != NULL) alloc->free(p, len); else delete[] (unsigned char*)p; } }
 	};
 	
 		// Simple flag helper to add or clear flags
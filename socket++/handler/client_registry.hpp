@@ -0,0 +1,182 @@
+#ifndef SOCKET_XX_HANDLER_CLIENT_REGISTRY_H
+#define SOCKET_XX_HANDLER_CLIENT_REGISTRY_H
+
+	// BaseIO
+#include <socket++/base_io.hpp>
+
+	// General headers
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <stdexcept>
+
+	// Threads
+#ifndef XIF_NO_THREADS
+	#include <pthread.h>
+#endif
+
+namespace socketxx { namespace end {
+
+		// Private tools
+	namespace _client_registry {
+
+			// Lookup of a client which is not retained
+		extern const std::out_of_range not_found;
+
+#ifndef XIF_NO_THREADS
+		struct mutex {
+			pthread_mutex_t m;
+			mutex () { ::pthread_mutex_init(&m, NULL); }
+			~mutex () { ::pthread_mutex_destroy(&m); }
+			mutex (const mutex&) = delete;
+		};
+		struct lock { pthread_mutex_t* const _m; lock (mutex& m) : _m(&m.m) { ::pthread_mutex_lock(_m); } ~lock () { ::pthread_mutex_unlock(_m); } };
+#else
+		struct mutex {};
+		struct lock { lock (mutex&) {} };
+#endif
+
+	}
+
+	/***** Registry of retained clients *****
+	 *
+	 *  Clients are spread by file descriptor over `n_shards` lists, each one with its own mutex : threads
+	 *   retaining, releasing or looking up different clients rarely wait for each other.
+	 *  Insertion, removal and lookup by fd or by client ID are O(1). The lists are only accessed with their
+	 *   shard's lock held; iteration works on copies of the clients (reference-counted) taken shard by shard,
+	 *   so it is safe while other threads modify the registry, and callbacks can retain or release clients.
+	 *  A client ID is unique for the registry's life. A released client stays usable through its copies.
+	 */
+	template <typename client>
+	class client_registry {
+	public:
+		static const unsigned n_shards = 16;
+		typedef uint64_t client_id;
+
+			// Handle of a retained client : a copy of the client and its ID. `h->` accesses the client.
+		struct handle {
+			client_id id;
+			client cli;
+			handle (client_id id, const client& c) : id(id), cli(c) {}
+			handle (client_id id, client&& c) : id(id), cli(std::move(c)) {}
+			client* operator-> () { return &cli; }
+			const client* operator-> () const { return &cli; }
+			client& operator* () { return cli; }
+			const client& operator* () const { return cli; }
+		};
+
+	private:
+		typedef std::list<handle> list_t;
+		struct shard {
+			list_t l;
+			std::unordered_map<fd_t, typename list_t::iterator> by_fd;
+			std::unordered_map<client_id, typename list_t::iterator> by_id;
+			mutable _client_registry::mutex m;
+		};
+		shard shards[n_shards];
+		std::atomic<uint64_t> seq;
+		std::atomic<size_t> n;
+
+			// The ID tells the shard : lookup by ID doesn't need the fd
+		static unsigned shard_of_fd (fd_t fd)       { return (unsigned)fd % n_shards; }
+		static unsigned shard_of_id (client_id id)  { return (unsigned)(id % n_shards); }
+			// The entry is moved to `dead`, destructed (and maybe closed) out of the lock
+		void erase_locked (shard& sh, typename list_t::iterator it, list_t& dead) { sh.by_fd.erase(it->cli.get_fd()); sh.by_id.erase(it->id); dead.splice(dead.end(), sh.l, it); n--; }
+			// The client is moved in the registry if it is an rvalue, and only if not already retained
+		template <typename C> handle _insert (C&& c) {
+			fd_t fd = c.get_fd();
+			shard& sh = shards[shard_of_fd(fd)];
+			_client_registry::lock _l (sh.m);
+			auto f = sh.by_fd.find(fd);
+			if (f != sh.by_fd.end())
+				return *f->second;
+			client_id id = seq.fetch_add(1, std::memory_order_relaxed) * n_shards + shard_of_fd(fd);
+			typename list_t::iterator it = sh.l.emplace(sh.l.end(), id, std::forward<C>(c));
+			sh.by_fd[fd] = it;
+			sh.by_id[id] = it;
+			n++;
+			return *it;
+		}
+
+	public:
+		client_registry () : seq(1), n(0) {}
+		client_registry (const client_registry&) = delete;
+		client_registry& operator= (const client_registry&) = delete;
+
+			// Retain a client. If already retained (same fd), returns the existing handle
+		handle insert (const client& c) { return this->_insert(c); }
+		handle insert (client&& c)      { return this->_insert(std::move(c)); }
+
+			// Release a client. Returns false if it was not retained
+		bool erase (client_id id) {
+			list_t dead;
+			shard& sh = shards[shard_of_id(id)];
+			_client_registry::lock _l (sh.m);
+			auto f = sh.by_id.find(id);
+			if (f == sh.by_id.end()) return false;
+			this->erase_locked(sh, f->second, dead);
+			return true;
+		}
+			// Release a client by fd. Returns its ID, or 0 if it was not retained (IDs are never 0)
+		client_id erase_fd (fd_t fd) {
+			list_t dead;
+			shard& sh = shards[shard_of_fd(fd)];
+			_client_registry::lock _l (sh.m);
+			auto f = sh.by_fd.find(fd);
+			if (f == sh.by_fd.end()) return 0;
+			client_id id = f->second->id;
+			this->erase_locked(sh, f->second, dead);
+			return id;
+		}
+
+			// Lookup. Throws `_client_registry::not_found` (std::out_of_range) if the client is not retained
+		handle find (client_id id) const {
+			const shard& sh = shards[shard_of_id(id)];
+			_client_registry::lock _l (sh.m);
+			auto f = sh.by_id.find(id);
+			if (f == sh.by_id.end()) throw _client_registry::not_found;
+			return *f->second;
+		}
+		handle find_fd (fd_t fd) const {
+			const shard& sh = shards[shard_of_fd(fd)];
+			_client_registry::lock _l (sh.m);
+			auto f = sh.by_fd.find(fd);
+			if (f == sh.by_fd.end()) throw _client_registry::not_found;
+			return *f->second;
+		}
+		bool contains (client_id id) const {
+			const shard& sh = shards[shard_of_id(id)];
+			_client_registry::lock _l (sh.m);
+			return sh.by_id.find(id) != sh.by_id.end();
+		}
+
+		size_t size () const { return n.load(std::memory_order_relaxed); }
+
+			// Copy of all retained clients, in shard order (each shard in retaining order)
+		void snapshot (std::vector<handle>& v) const {
+			v.clear();
+			v.reserve(this->size());
+			for (unsigned s = 0; s < n_shards; s++) {
+				_client_registry::lock _l (shards[s].m);
+				for (const handle& h : shards[s].l)
+					v.push_back(h); // Clients are not assignable : no range insert
+			}
+		}
+
+			// Release all clients
+		void clear () {
+			for (unsigned s = 0; s < n_shards; s++) {
+				list_t dead;
+				_client_registry::lock _l (shards[s].m);
+				n -= shards[s].l.size();
+				shards[s].by_fd.clear();
+				shards[s].by_id.clear();
+				dead.swap(shards[s].l);
+			}
+		}
+	};
+
+}}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef SOCKET_XX_HANDLER_DGRAM_SERVER_H
+#define SOCKET_XX_HANDLER_DGRAM_SERVER_H
+
+	// BaseIO
+#include <socket++/base_dgram.hpp>
+
+	// Pool tools (pool_ret_t, select warpers)
+#include <socket++/handler/socket_server.hpp>
+
+	// General headers
+#include <vector>
+#include <functional>
+
+namespace socketxx { namespace end {
+
+	/***** Datagram server *****
+	 *
+	 *  Datagram socket bound to an address, receiving datagrams by batches in a loop, as socket_server's wait_activity_loop().
+	 *  When the socket is readable, batches are received without waiting until it is drained, so a burst of datagrams
+	 *   costs one select() and one recvmmsg() per batch. Replies can be sent with o_dgram() or o_batch() from the callback.
+	 *  Several servers (threads, or processes : see prefork) can bind the same address with `reuse_port` :
+	 *   the kernel spreads datagrams over them.
+	 */
+	template <typename dgram_base>
+	class dgram_server : public dgram_base {
+	public:
+		typedef typename dgram_base::batch batch;
+		typedef std::function<pool_ret_t(batch&)> batch_callback_t;
+		typedef std::function<pool_ret_t(fd_t)> fd_callback_t;
+
+	protected:
+			// Timeout
+		timeval pool_timeout;
+		void _receive_loop (batch& b, batch_callback_t f, const std::vector<fd_t>& fds, fd_callback_t fd_activity_f);
+
+			// Forbidden constructors
+		dgram_server () = delete;
+		dgram_server (const dgram_server& other) = delete;
+
+	public:
+			// Constructor : create the socket and bind it
+		dgram_server (typename dgram_base::addr_info addr, bool reuse_port = false) : dgram_base(), pool_timeout(TIMEOUT_INF) { this->bind(addr, reuse_port); }
+		virtual ~dgram_server () noexcept {}
+
+			// Set pool-timeout, used as maximum wait timeout in the loop. Null timeout disable it.
+		void set_pool_timeout (timeval timeout) { pool_timeout = timeout; }
+
+			// Receive in loop : each batch of datagrams received in `b` is passed to `batch_f`. Quits if any callback returns `POOL_QUIT`.
+			//  Timeout exceptions are thrown (pool-timeout counted since the last activity). Interruptions of syscalls are ignored.
+		void receive_loop (batch& b, batch_callback_t batch_f)                                                            { _receive_loop(b, batch_f, {}, nullptr); }
+			// Additonally, monitor activity on abritrary file descriptors (stdin, pipes, files…)
+		void receive_loop (batch& b, batch_callback_t batch_f, fd_t fd_monitor, fd_callback_t fd_activity_f)              { _receive_loop(b, batch_f, {fd_monitor}, fd_activity_f); }
+		void receive_loop (batch& b, batch_callback_t batch_f, const std::vector<fd_t>& fds, fd_callback_t fd_activity_f) { _receive_loop(b, batch_f, fds, fd_activity_f); }
+	};
+
+		///--- Implementation ---///
+
+	template <typename dgram_base>
+	void dgram_server<dgram_base>::_receive_loop (batch& b, batch_callback_t batch_f, const std::vector<fd_t>& fds, fd_callback_t fd_activity_f) {
+		fd_set set;
+		FD_ZERO(&set);
+		FD_SET(this->fd, &set);
+		fd_t maxfd = this->fd;
+		for (fd_t fd_monitor : fds) {
+			FD_SET(fd_monitor, &set);
+			if (fd_monitor > maxfd) maxfd = fd_monitor;
+		}
+		for (;;) {
+			fd_set cpset = set;
+			_socket_server::_select(maxfd, &cpset, pool_timeout);
+			for (fd_t fd_monitor : fds)
+				if (FD_ISSET(fd_monitor, &cpset) and fd_activity_f(fd_monitor) == POOL_QUIT)
+					return;
+			if (FD_ISSET(this->fd, &cpset)) {
+					// Drain the socket
+				while (this->i_batch(b, false) != 0) {
+					if (batch_f(b) == POOL_QUIT)
+						return;
+					if (b.count() < b.capacity())
+						break;
+				}
+			}
+		}
+	}
+
+}}
+
+#endif
@@ -0,0 +1,182 @@
+#include <socket++/handler/prefork.hpp>
+
+	// Errors
+#include <socket++/base_io.hpp>
+
+	// Clock
+#include <socket++/handler/timer_wheel.hpp>
+
+	// OS headers
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/wait.h>
+
+	// General headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace socketxx { namespace end {
+
+	namespace _prefork {
+		const std::logic_error already_active ("prefork : a supervisor is already started in this process");
+
+			// Self-pipe of the started supervisor, written by the SIGCHLD handler
+		static volatile sig_atomic_t chld_fd = -1;
+		static void sigchld (int) {
+			int e = errno;
+			if (chld_fd != -1) (void)::write(chld_fd, "", 1);
+			errno = e;
+		}
+
+		static const uint64_t no_respawn = UINT64_MAX;
+	}
+
+	/************* Prefork supervisor Implementation *************/
+
+	int prefork::cur_worker = -1;
+
+	prefork::prefork (unsigned n_workers, worker_f f) : workers(n_workers, worker({0,0,_prefork::no_respawn})), f(f), on_exit(nullptr), respawn(true), respawn_ms(1000), stopping(0), stop_sig(SIGTERM), killed(false), started(false) {
+		evt[0] = evt[1] = SOCKETXX_INVALID_HANDLE;
+	}
+
+	void prefork::start () {
+		if (_prefork::chld_fd != -1) throw _prefork::already_active;
+		if (::pipe(evt) == -1) throw socketxx::other_error("prefork : failed to create pipe");
+		for (fd_t p : evt) {
+			::fcntl(p, F_SETFL, ::fcntl(p, F_GETFL) | O_NONBLOCK);
+			::fcntl(p, F_SETFD, FD_CLOEXEC);
+		}
+		struct sigaction sa;
+		::memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = &_prefork::sigchld;
+		sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+		::sigemptyset(&sa.sa_mask);
+		_prefork::chld_fd = evt[1];
+		::sigaction(SIGCHLD, &sa, &old_chld);
+		started = true;
+		uint64_t now = timer_wheel::now_ms();
+		for (unsigned i = 0; i < workers.size(); i++)
+			this->spawn(i, now);
+	}
+
+	void prefork::spawn (unsigned i, uint64_t now) {
+		::fflush(NULL); // Else buffered output would be written by both processes
+		pid_t pid = ::fork();
+		if (pid == -1) { // Retried later
+			workers[i].respawn_at = now + respawn_ms;
+			return;
+		}
+		if (pid == 0) {
+				// Worker
+			_prefork::chld_fd = -1;
+			::sigaction(SIGCHLD, &old_chld, NULL);
+			::close(evt[0]);
+			::close(evt[1]);
+			cur_worker = (int)i;
+			int st;
+			try {
+				st = f(i);
+			} catch (...) {
+				st = EXIT_FAILURE;
+			}
+			::fflush(NULL);
+			::_exit(st);
+		}
+		workers[i] = worker({pid, now, _prefork::no_respawn});
+	}
+
+	bool prefork::handle_events () {
+		char buf[64];
+		while (::read(evt[0], buf, sizeof(buf)) > 0) ;
+		uint64_t now = timer_wheel::now_ms();
+			// Reap
+		for (unsigned i = 0; i < workers.size(); i++) {
+			worker& w = workers[i];
+			int st;
+			if (w.pid == 0 or ::waitpid(w.pid, &st, WNOHANG) != w.pid)
+				continue;
+			pid_t pid = w.pid;
+			w.pid = 0;
+			w.respawn_at = (respawn and not stopping) ? ((now - w.started < respawn_ms) ? w.started + respawn_ms : now) : _prefork::no_respawn;
+			if (on_exit != nullptr)
+				on_exit(i, pid, st);
+		}
+			// Stop or respawn
+		if (stopping) {
+			if (not killed) {
+				for (worker& w : workers)
+					if (w.pid != 0) ::kill(w.pid, stop_sig);
+				killed = true;
+			}
+			return this->alive() != 0;
+		}
+		for (unsigned i = 0; i < workers.size(); i++)
+			if (workers[i].pid == 0 and workers[i].respawn_at <= now)
+				this->spawn(i, now);
+		return true;
+	}
+
+	timeval prefork::next_timeout () const {
+		uint64_t next = _prefork::no_respawn;
+		for (const worker& w : workers)
+			if (w.pid == 0 and w.respawn_at < next)
+				next = w.respawn_at;
+		if (next == _prefork::no_respawn or stopping)
+			return TIMEOUT_INF;
+		uint64_t now = timer_wheel::now_ms();
+		uint64_t d = (next > now) ? next - now : 0;
+		return timeval({ (time_t)(d/1000), (suseconds_t)(d%1000)*1000 });
+	}
+
+	void prefork::run () {
+		if (not started)
+			this->start();
+		while (this->handle_events()) {
+			timeval tm = this->next_timeout();
+			pollfd p = { evt[0], POLLIN, 0 };
+			::poll(&p, 1, (tm == TIMEOUT_INF) ? -1 : (int)(tm.tv_sec*1000 + (tm.tv_usec+999)/1000));
+		}
+	}
+
+	void prefork::stop (int sig) noexcept {
+		stop_sig = sig;
+		stopping = 1;
+		if (evt[1] != SOCKETXX_INVALID_HANDLE) {
+			int e = errno;
+			(void)::write(evt[1], "", 1);
+			errno = e;
+		}
+	}
+
+	unsigned prefork::alive () const {
+		unsigned n = 0;
+		for (const worker& w : workers)
+			if (w.pid != 0) n++;
+		return n;
+	}
+
+	void prefork::cleanup () noexcept {
+		if (not started)
+			return;
+		for (worker& w : workers)
+			if (w.pid != 0) {
+				::kill(w.pid, SIGKILL);
+				while (::waitpid(w.pid, NULL, 0) == -1 and errno == EINTR) ;
+				w.pid = 0;
+			}
+		_prefork::chld_fd = -1;
+		::sigaction(SIGCHLD, &old_chld, NULL);
+		::close(evt[0]);
+		::close(evt[1]);
+		evt[0] = evt[1] = SOCKETXX_INVALID_HANDLE;
+		started = false;
+	}
+
+	prefork::~prefork () noexcept {
+		this->cleanup();
+	}
+
+}}
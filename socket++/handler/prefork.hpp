@@ -0,0 +1,89 @@
+#ifndef SOCKET_XX_HANDLER_PREFORK_H
+#define SOCKET_XX_HANDLER_PREFORK_H
+
+	// Defs
+#include <socket++/defs.hpp>
+
+	// General headers
+#include <vector>
+#include <functional>
+#include <stdexcept>
+
+	// OS headers
+#include <sys/types.h>
+#include <signal.h>
+
+namespace socketxx { namespace end {
+
+		// Private tools
+	namespace _prefork {
+			// Only one supervisor can be started per process (SIGCHLD handler)
+		extern const std::logic_error already_active;
+	}
+
+	/***** Prefork multi-process supervisor *****
+	 *
+	 *  Forks N worker processes running `worker_f(index)`, whose return value is the worker's exit status.
+	 *  Dead workers are respawned (after `respawn_delay` if the worker lived less than that, to avoid crash loops).
+	 *  Typical use with a socket_server : create the server listening in the parent, set_shared_listener(true), and run
+	 *   its wait_activity_loop() in each worker. The kernel distributes clients over processes, with no shared state.
+	 *  Workers can also receive clients from an acceptor process over UNIX sockets (see base_unixsock::o_sock()) : the
+	 *   parent can run its own loop, monitoring event_fd() and calling handle_events() on activity.
+	 *  The supervisor installs a SIGCHLD handler while started : only one can be started per process.
+	 */
+	class prefork {
+	public:
+		typedef std::function<int(unsigned)> worker_f;
+		typedef std::function<void(unsigned, pid_t, int)> exit_f; // Worker index, pid, status as given by waitpid()
+
+		prefork (unsigned n_workers, worker_f f);
+		prefork (const prefork&) = delete;
+		prefork& operator= (const prefork&) = delete;
+		~prefork () noexcept; // Workers still running are killed (SIGKILL) and reaped
+
+			// A worker which lived less than `delay` is respawned `delay` after its start (1s by default). TIMEOUT_INF disables respawning.
+		void set_respawn_delay (timeval delay) { respawn = not (delay == TIMEOUT_INF); if (respawn) respawn_ms = (uint64_t)delay.tv_sec*1000 + (uint64_t)delay.tv_usec/1000; }
+			// Called in the parent when a worker exits
+		void set_exit_callback (exit_f f) { on_exit = f; }
+
+			// Fork all workers
+		void start ();
+			// Readable when a worker exited or stop() was called : then call handle_events()
+		fd_t event_fd () const { return evt[0]; }
+			// Reap dead workers, respawn them, and on stop, terminate them. Returns false once stopped and all workers reaped.
+		bool handle_events ();
+			// Time until the next delayed respawn. TIMEOUT_INF if none.
+		timeval next_timeout () const;
+			// start(), then supervise until stop() and the end of all workers
+		void run ();
+			// Terminate workers with `sig` and stop respawning. Async-signal-safe : can be called from a SIGTERM handler.
+		void stop (int sig = SIGTERM) noexcept;
+
+			// Workers' info
+		unsigned size () const { return (unsigned)workers.size(); }
+		unsigned alive () const;
+		pid_t worker_pid (unsigned i) const { return workers.at(i).pid; } // 0 if not running
+			// In a worker process : its index. -1 in the supervisor.
+		static int worker_index () { return cur_worker; }
+
+	private:
+		struct worker { pid_t pid; uint64_t started; uint64_t respawn_at; };
+		std::vector<worker> workers;
+		worker_f f;
+		exit_f on_exit;
+		bool respawn;
+		uint64_t respawn_ms;
+		fd_t evt[2];                          // Self-pipe
+		volatile sig_atomic_t stopping;
+		int stop_sig;
+		bool killed, started;
+		struct sigaction old_chld;
+		static int cur_worker;
+
+		void spawn (unsigned i, uint64_t now);
+		void cleanup () noexcept;
+	};
+
+}}
+
+#endif
@@ -0,0 +1,33 @@
+#include <socket++/handler/rpc_mux.hpp>
+
+#ifndef XIF_NO_THREADS
+
+	// Swapping of simple_socket
+#include <socket++/io/simple_socket.hpp>
+
+namespace socketxx { namespace end { namespace _rpc_mux {
+
+	const socketxx::error closed ("rpc_mux : closed");
+	const socketxx::error bad_message ("rpc_mux : invalid message");
+	const std::logic_error not_raw ("rpc_mux : BaseIO must write unmodified data to the socket");
+
+	thread_local const void* reader_of = NULL;
+
+	void put_hdr (char* p, uint64_t id, kind_t kind) {
+		if (not XIF_SOCKETXX_ENDIANNESS_SAME) io::_simple_socket::swapBytes(&id, sizeof(uint64_t));
+		::memcpy(p, &id, sizeof(uint64_t));
+		p[sizeof(uint64_t)] = (char)kind;
+	}
+
+	bool get_hdr (const char* p, size_t len, uint64_t& id, kind_t& kind) {
+		if (len < hdr_sz or (uint8_t)p[sizeof(uint64_t)] > ERROR)
+			return false;
+		::memcpy(&id, p, sizeof(uint64_t));
+		if (not XIF_SOCKETXX_ENDIANNESS_SAME) io::_simple_socket::swapBytes(&id, sizeof(uint64_t));
+		kind = (kind_t)p[sizeof(uint64_t)];
+		return true;
+	}
+
+}}}
+
+#endif
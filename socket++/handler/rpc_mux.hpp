@@ -0,0 +1,340 @@
+#ifndef SOCKET_XX_HANDLER_RPC_MUX_H
+#define SOCKET_XX_HANDLER_RPC_MUX_H
+
+	// BaseIO
+#include <socket++/base_io.hpp>
+
+	// Frames
+#include <socket++/io/framed_socket.hpp>
+
+#ifndef XIF_NO_THREADS
+
+	// General headers
+#include <string>
+#include <unordered_map>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+
+	// Threads
+#include <pthread.h>
+
+	// OS headers
+#include <sys/socket.h>
+
+namespace socketxx { namespace end {
+
+		// Error response of the peer's request handler
+	class rpc_error : public socketxx::error {
+	protected:
+		std::string _what;
+		virtual std::string descr () const { return _what; }
+	public:
+		rpc_error (std::string what) : error(), _what(what) {}
+		virtual ~rpc_error() noexcept {}
+	};
+
+		// Private tools
+	namespace _rpc_mux {
+
+			// Calls failed because the multiplexer was closed, or the peer sent an invalid message
+		extern const socketxx::error closed;
+		extern const socketxx::error bad_message;
+			// The BaseIO can't be read and written at the same time by two threads (TLS, compression)
+		extern const std::logic_error not_raw;
+
+			// Message header, before the payload in each frame : request ID and kind
+		enum kind_t : uint8_t { REQUEST = 0, RESPONSE = 1, ERROR = 2 };
+		const size_t hdr_sz = sizeof(uint64_t) + 1;
+		void put_hdr (char* p, uint64_t id, kind_t kind);
+		bool get_hdr (const char* p, size_t len, uint64_t& id, kind_t& kind);
+
+		struct mutex {
+			pthread_mutex_t m;
+			mutex () { ::pthread_mutex_init(&m, NULL); }
+			~mutex () { ::pthread_mutex_destroy(&m); }
+			mutex (const mutex&) = delete;
+		};
+		struct lock { pthread_mutex_t* const _m; lock (mutex& m) : _m(&m.m) { ::pthread_mutex_lock(_m); } ~lock () { ::pthread_mutex_unlock(_m); } };
+		struct cond {
+			pthread_cond_t c;
+			cond () { ::pthread_cond_init(&c, NULL); }
+			~cond () { ::pthread_cond_destroy(&c); }
+			cond (const cond&) = delete;
+		};
+
+			// Multiplexer whose reader thread is the current thread, if any
+		extern thread_local const void* reader_of;
+
+	}
+
+	/***** Multiplexed RPC over one connection *****
+	 *
+	 *  Requests and responses are framed_socket frames tagged with a request ID : many threads can issue requests
+	 *   on the same connection without waiting for each other's responses (pipelining), and responses can come back
+	 *   in any order. A dedicated reader thread receives all frames, and dispatches responses to the waiting callers
+	 *   (futures, or callbacks called in the reader thread) and requests of the peer to the request handler.
+	 *  Both sides can send requests. The request handler is called in the reader thread : it must not block, and should
+	 *   pass long processing to other threads, which reply() later, in any order. An exception thrown by the handler
+	 *   is sent as an error response.
+	 *  The reader thread never writes to the socket : with both peers pipelining, two readers blocked on full socket
+	 *   buffers would wait for each other forever. Messages sent from it (replies and calls of the handler and of the
+	 *   callbacks, error responses) are queued, without limit, and sent by a writer thread. Other threads send at once.
+	 *  Sending is serialized by a mutex, each message with one sendmsg(). Only BaseIOs writing unmodified data to the
+	 *   socket can be used (not base_ssl, nor base_compressed) : they are read and written by different threads.
+	 *  When the connection fails or close() is called, the reader thread stops, and pending and further calls fail
+	 *   with the error. close() shuts the connection down for all copies of the socket.
+	 */
+	template <typename io_base>
+	class rpc_mux {
+		static_assert(std::is_base_of<socketxx::base_socket, io_base>::value, "rpc_mux needs a socket");
+	public:
+		typedef uint64_t req_id;
+		typedef typename io::framed_socket<io_base>::frame frame;
+			// Response callback, called in the reader thread. `err` is null on success, else the error (rpc_error, io_error...)
+			//  and `resp` is empty. The response is only valid during the call. Callbacks must not throw : the reader thread would stop.
+		typedef std::function<void(std::exception_ptr err, frame resp)> response_f;
+			// Request handler, called in the reader thread. The request is only valid during the call.
+		typedef std::function<void(req_id id, frame req)> request_f;
+
+	private:
+			// Access to the I/O functions of the framed socket
+		struct sock_t : public io::framed_socket<io_base> {
+			sock_t (const io_base& iob) : io::framed_socket<io_base>(iob) {}
+			bool raw () { return this->_get_io_fncts().raw; }
+		} sock;
+		request_f handler;
+			// Pending requests, with their callbacks
+		std::unordered_map<req_id, response_f> pending;
+		std::exception_ptr failure;                  // Set when the reader thread stops : calls fail at once
+		_rpc_mux::mutex m_pending, m_write;
+		std::atomic<req_id> seq;
+		std::atomic<bool> closing;
+		pthread_t reader;
+		bool joined;
+			// Messages sent from the reader thread (header and payload), for the writer thread
+		std::deque<std::string> queue;
+		_rpc_mux::mutex m_queue;
+		_rpc_mux::cond c_queue;
+		bool stop_writer;
+		pthread_t writer;
+
+		void _send (req_id id, _rpc_mux::kind_t kind, const void* d, size_t len);
+		void _fail_all (std::exception_ptr err);
+		void _read_loop ();
+		void _write_loop ();
+		static void* _reader (void* self) { _rpc_mux::reader_of = self; ((rpc_mux*)self)->_read_loop(); return NULL; }
+		static void* _writer (void* self) { ((rpc_mux*)self)->_write_loop(); return NULL; }
+
+	public:
+			// Start the reader and writer threads on a connected socket. Without handler, requests of the peer get an error response.
+		rpc_mux (const io_base& s, request_f handler = nullptr);
+		rpc_mux (const rpc_mux&) = delete;
+		rpc_mux& operator= (const rpc_mux&) = delete;
+			// Closes the connection and waits for the threads
+		~rpc_mux () noexcept { this->close(); }
+
+			// Maximum size of messages (see framed_socket). Set before sending requests.
+		void set_max_frame (uint32_t max) { sock.set_max_frame(max); }
+
+			// Send a request. The response is returned as a copy in the future, or passed to `f` as a view.
+			//  Thread-safe. Sending errors are thrown.
+		std::future<std::string> call (const void* d, size_t len);
+		std::future<std::string> call (const std::string& req) { return this->call(req.data(), req.length()); }
+		void call (const void* d, size_t len, response_f f);
+
+			// Reply to a request of the peer, from any thread, in any order
+		void reply (req_id id, const void* d, size_t len)       { this->_send(id, _rpc_mux::RESPONSE, d, len); }
+		void reply (req_id id, const std::string& resp)         { this->_send(id, _rpc_mux::RESPONSE, resp.data(), resp.length()); }
+		void reply_error (req_id id, const std::string& what)   { this->_send(id, _rpc_mux::ERROR, what.data(), what.length()); }
+
+			// Requests waiting for their response
+		size_t outstanding ();
+			// The reader thread is running
+		bool alive ();
+
+			// Shut the connection down and wait for the threads. Pending calls fail, queued messages are dropped. Can't be called from callbacks.
+		void close () noexcept;
+	};
+
+		///--- Implementation ---///
+
+	template <typename io_base>
+	rpc_mux<io_base>::rpc_mux (const io_base& s, request_f handler) : sock(s), handler(handler), seq(1), closing(false), joined(false), stop_writer(false) {
+		if (not sock.raw())
+			throw _rpc_mux::not_raw;
+		if (::pthread_create(&writer, NULL, &rpc_mux::_writer, this) != 0)
+			throw socketxx::other_error("Failed to create rpc_mux writer thread");
+		if (::pthread_create(&reader, NULL, &rpc_mux::_reader, this) != 0) {
+			{ _rpc_mux::lock l (m_queue);
+				stop_writer = true;
+				::pthread_cond_signal(&c_queue.c);
+			}
+			::pthread_join(writer, NULL);
+			throw socketxx::other_error("Failed to create rpc_mux reader thread");
+		}
+	}
+
+	template <typename io_base>
+	void rpc_mux<io_base>::_send (req_id id, _rpc_mux::kind_t kind, const void* d, size_t len) {
+		char hdr[_rpc_mux::hdr_sz];
+		_rpc_mux::put_hdr(hdr, id, kind);
+		if (_rpc_mux::reader_of == this) { // Queued for the writer thread : the reader must not block
+			std::string msg (hdr, _rpc_mux::hdr_sz);
+			msg.append((const char*)d, len);
+			_rpc_mux::lock l (m_queue);
+			queue.push_back(std::move(msg));
+			::pthread_cond_signal(&c_queue.c);
+			return;
+		}
+		iovec v[2] = { { hdr, _rpc_mux::hdr_sz }, { const_cast<void*>(d), len } };
+		_rpc_mux::lock l (m_write);
+		sock.o_frame(v, 2);
+	}
+
+	template <typename io_base>
+	void rpc_mux<io_base>::call (const void* d, size_t len, response_f f) {
+		req_id id = seq.fetch_add(1, std::memory_order_relaxed);
+		std::exception_ptr err;
+		{ _rpc_mux::lock l (m_pending);
+			if (failure) err = failure;
+			else pending.emplace(id, std::move(f));
+		}
+		if (err) {
+			f(err, frame({ NULL, 0 }));
+			return;
+		}
+		try {
+			this->_send(id, _rpc_mux::REQUEST, d, len);
+		} catch (...) {
+			_rpc_mux::lock l (m_pending);
+			pending.erase(id);
+			throw;
+		}
+	}
+
+	template <typename io_base>
+	std::future<std::string> rpc_mux<io_base>::call (const void* d, size_t len) {
+		std::shared_ptr<std::promise<std::string>> p = std::make_shared<std::promise<std::string>>();
+		std::future<std::string> fut = p->get_future();
+		this->call(d, len, [p] (std::exception_ptr err, frame resp) {
+			if (err) p->set_exception(err);
+			else p->set_value(resp.str());
+		});
+		return fut;
+	}
+
+	template <typename io_base>
+	void rpc_mux<io_base>::_fail_all (std::exception_ptr err) {
+		std::unordered_map<req_id, response_f> failed;
+		{ _rpc_mux::lock l (m_pending);
+			failure = err;
+			failed.swap(pending);
+		}
+		for (auto& p : failed)
+			p.second(err, frame({ NULL, 0 }));
+	}
+
+	template <typename io_base>
+	void rpc_mux<io_base>::_read_loop () {
+		for (;;) {
+			frame f;
+			req_id id;
+			_rpc_mux::kind_t kind;
+			try {
+				f = sock.i_frame();
+				if (not _rpc_mux::get_hdr(f.data, f.len, id, kind))
+					throw _rpc_mux::bad_message;
+			} catch (...) {
+				if (closing.load()) _fail_all(std::make_exception_ptr(_rpc_mux::closed));
+				else _fail_all(std::current_exception());
+				return;
+			}
+			frame body = { f.data + _rpc_mux::hdr_sz, f.len - _rpc_mux::hdr_sz };
+			try {
+				if (kind == _rpc_mux::REQUEST) {
+					if (not handler) {
+						this->reply_error(id, "no request handler");
+						continue;
+					}
+					try {
+						handler(id, body);
+					} catch (socketxx::io_error&) {
+						throw;
+					} catch (std::exception& e) {
+						this->reply_error(id, e.what());
+					}
+				} else {
+					response_f cb;
+					{ _rpc_mux::lock l (m_pending);
+						auto it = pending.find(id);
+						if (it == pending.end()) continue; // Failed to be sent, or unknown
+						cb = std::move(it->second);
+						pending.erase(it);
+					}
+					if (kind == _rpc_mux::ERROR) cb(std::make_exception_ptr(rpc_error(body.str())), frame({ NULL, 0 }));
+					else                         cb(nullptr, body);
+				}
+			} catch (...) {
+				_fail_all(std::current_exception());
+				return;
+			}
+		}
+	}
+
+	template <typename io_base>
+	void rpc_mux<io_base>::_write_loop () {
+		for (;;) {
+			std::string msg;
+			{ _rpc_mux::lock l (m_queue);
+				while (queue.empty() and not stop_writer)
+					::pthread_cond_wait(&c_queue.c, &m_queue.m);
+				if (stop_writer) return;
+				msg = std::move(queue.front());
+				queue.pop_front();
+			}
+			try {
+				_rpc_mux::lock l (m_write);
+				sock.o_frame(msg);
+			} catch (...) {
+				::shutdown(sock.get_fd(), SHUT_RDWR); // The reader thread fails the pending calls
+			}
+		}
+	}
+
+	template <typename io_base>
+	size_t rpc_mux<io_base>::outstanding () {
+		_rpc_mux::lock l (m_pending);
+		return pending.size();
+	}
+
+	template <typename io_base>
+	bool rpc_mux<io_base>::alive () {
+		_rpc_mux::lock l (m_pending);
+		return not failure;
+	}
+
+	template <typename io_base>
+	void rpc_mux<io_base>::close () noexcept {
+		if (joined) return;
+		closing.store(true);
+		::shutdown(sock.get_fd(), SHUT_RDWR);
+		::pthread_join(reader, NULL);
+		{ _rpc_mux::lock l (m_queue);
+			stop_writer = true;
+			::pthread_cond_signal(&c_queue.c);
+		}
+		::pthread_join(writer, NULL);
+		joined = true;
+	}
+
+}}
+
+#endif
+
+#endif
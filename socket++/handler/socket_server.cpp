@@ -4,6 +4,8 @@
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 
 namespace socketxx { namespace end {
 	
@@ -25,11 +27,32 @@ namespace socketxx { namespace end {
 			if (r == -1) throw server_launch_error(server_launch_error::LISTEN_ERR);
 		}
 		
-			// Warper for accept() : return the new client's socket
-		socket_t _server_accept (socket_t sock, sockaddr* addr, socklen_t* addrlen) {
-			socket_t cli_sock = ::accept(sock, addr, addrlen);
-			if (cli_sock == -1) throw server_pool_error(server_pool_error::ACCEPT_ERR);
-			return cli_sock;
+			// Warper for accept() : the new client's socket is set in `cli_sock`
+		bool _server_accept (socket_t sock, sockaddr* addr, socklen_t* addrlen, socket_t& cli_sock, bool shared, bool try_only) {
+			socklen_t len = *addrlen;
+			while ((cli_sock = ::accept(sock, addr, addrlen)) == -1) {
+				if (not shared or (errno != EAGAIN and errno != EWOULDBLOCK and errno != ECONNABORTED and errno != EINTR))
+					throw server_pool_error(server_pool_error::ACCEPT_ERR);
+				if (try_only)
+					return false;
+				pollfd p = { sock, POLLIN, 0 };
+				::poll(&p, 1, -1);
+				*addrlen = len;
+			}
+		#ifndef __linux__
+			if (shared) { // Accepted sockets inherit O_NONBLOCK on BSDs
+				int fl = ::fcntl(cli_sock, F_GETFL);
+				if (fl != -1 and (fl & O_NONBLOCK)) ::fcntl(cli_sock, F_SETFL, fl & ~O_NONBLOCK);
+			}
+		#endif
+			return true;
+		}
+		
+			// Set the listening socket's non-blocking mode
+		void _server_shared (socket_t sock, bool shared) {
+			int fl = ::fcntl(sock, F_GETFL);
+			if (fl == -1 or ::fcntl(sock, F_SETFL, shared ? (fl | O_NONBLOCK) : (fl & ~O_NONBLOCK)) == -1)
+				throw socketxx::other_error("Failed to set listening socket mode");
 		}
 		
 			// Create client thread
@@ -112,6 +135,10 @@ namespace socketxx { namespace end {
 		
 	}
 	
+	namespace _client_registry {
+		const std::out_of_range not_found("socket server : Client not retained");
+	}
+	
 		/** -------------- Exceptions -------------- **/
 	
 	std::string server_launch_error::descr() const {
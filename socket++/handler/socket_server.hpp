@@ -4,11 +4,18 @@
 	// BaseIO
 #include <socket++/base_io.hpp>
 
+	// Registry of retained clients
+#include <socket++/handler/client_registry.hpp>
+
+	// Idle timeouts
+#include <socket++/handler/timer_wheel.hpp>
+
 	// General headers
-#include <list>
 #include <vector>
+#include <unordered_map>
 #include <functional>
 #include <stdexcept>
+#include <atomic>
 
 	// Threads
 #ifndef XIF_NO_THREADS
@@ -54,8 +61,12 @@ namespace socketxx {
 			// Start listening state : create, bind, and put in listening state
 		void _server_launch (socket_t sock, const sockaddr* addr, size_t addrlen, u_int listen_max, bool reuse);
 		
-			// Warper for accept() : return the new client's socket
-		socket_t _server_accept (socket_t sock, sockaddr* addr, socklen_t* addrlen);
+			// Warper for accept() : sets `cli_sock` to the new client's socket and returns true
+			// With a shared (non-blocking) listener, waits again if the client was taken by another process,
+			//  or returns false if `try_only`
+		bool _server_accept (socket_t sock, sockaddr* addr, socklen_t* addrlen, socket_t& cli_sock, bool shared = false, bool try_only = false);
+			// Set the listening socket's non-blocking mode
+		void _server_shared (socket_t sock, bool shared);
 		
 			// Create client thread
 		pthread_t _server_cli_new_thread (void*(*thread_fnct)(server_thread_data*), void* new_client_ptr);
@@ -65,6 +76,9 @@ namespace socketxx {
 		void _select_throw_stop (fd_t fd1, std::vector<fd_t>& fds, timeval timeout, bool ignsig); // Throw a `stop_exception` on any fd activity in `fds` (first fd in `fds` priority)
 		uint _select (int maxsock, fd_set* set, timeval timeout); // Simple and transparent warper for select
 		
+			// Timeout in ms, rounded up. 0 for null timeout and TIMEOUT_INF
+		inline uint64_t _timeout_ms (timeval t) { if (t == TIMEOUT_INF) return 0; return (uint64_t)t.tv_sec*1000 + ((uint64_t)t.tv_usec+999)/1000; }
+		
 			// Listening state exception
 		extern const std::logic_error bad_state;
 	}
@@ -100,35 +114,46 @@ namespace socketxx {
 			_base_client () = delete;
 			_base_client (socket_t new_sock, typename socket_base::addr_info _addr) : socket_base(true, new_sock), addr(_addr) {}
 			_base_client (const _base_client& other) : socket_base(other), addr(other.addr) {}
+			_base_client (_base_client&& other) noexcept : socket_base(std::move(other)), addr(other.addr) {}
 		};
 		
 			/// Client with data
 		template <typename _data, typename dummy>
 		class _client : public _base_client {
 		private:
-			REFCXX_REFCOUNTED(_server_client);
+				// User data and its reference count, in one allocation. Shared by copies, NULL in a moved-from client.
+			struct _data_blk {
+				std::atomic<unsigned> refs;
+				_data d;
+				_data_blk () : refs(1), d() {}
+				_data_blk (const _data& o) : refs(1), d(o) {}
+			};
+			_data_blk* _b;
+			void _unref () noexcept { if (_b != NULL and _b->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete _b; }
 		protected:
 			friend class socket_server;
-				// User data
-			_data* const _d;
 				// Private constructors
 			_client () = delete;
-			_client (socket_t socket, typename socket_base::addr_info _addr) : _base_client(socket, _addr), REFCXX_CONSTRUCTOR(_server_client), _d(new _data) {}
-			_client (const _client& other, cli_data_t* data) : _base_client(other), REFCXX_COPY_CONSTRUCTOR(_server_client, other), _d(new _data (*data)) {}
+			_client (socket_t socket, typename socket_base::addr_info _addr) : _base_client(socket, _addr), _b(new _data_blk) {}
+			_client (const _client& other, cli_data_t* data) : _base_client(other), _b(data != NULL ? new _data_blk (*data) : new _data_blk) {}
+			_client (_client&& other, cli_data_t* data) : _base_client(std::move(other)), _b(data != NULL ? new _data_blk (*data) : new _data_blk) {}
 		public:
 				// Copy constructor
-			_client (const _client& other) : _base_client(other), REFCXX_COPY_CONSTRUCTOR(_server_client, other), _d(other._d) {}
+			_client (const _client& other) : _base_client(other), _b(other._b) { if (_b != NULL) _b->refs.fetch_add(1, std::memory_order_relaxed); }
+				// Move constructor : no reference counting
+			_client (_client&& other) noexcept : _base_client(std::move(other)), _b(other._b) { other._b = NULL; }
+			_client& operator= (const _client&) = delete;
 #ifndef XIF_NO_THREADS
 				// Constructor from server_thread_data
-			_client (server_thread_data* d) : _client(*((_client*)d->_c)) { delete (_client*)d->_c; delete d; }
+			_client (server_thread_data* d) : _client(std::move(*((_client*)d->_c))) { delete (_client*)d->_c; delete d; }
 #endif
 				// User data accessing
-			const _data& operator-> () const { return *_d; }
-			_data& operator-> () { return *_d; }
-			const _data& data () const { return *_d; }
-			_data& data () { return *_d; }
+			const _data& operator-> () const { return _b->d; }
+			_data& operator-> () { return _b->d; }
+			const _data& data () const { return _b->d; }
+			_data& data () { return _b->d; }
 				// Destruct user data
-			~_client () noexcept { REFCXX_DESTRUCT(_server_client) { delete _d; } }
+			~_client () noexcept { this->_unref(); }
 		};
 		
 			/// Client without data
@@ -140,12 +165,15 @@ namespace socketxx {
 			_client () = delete;
 			_client (socket_t socket, typename socket_base::addr_info _addr) : _base_client(socket, _addr) {}
 			_client (const _client& other, cli_data_t* data) : _base_client(other) {} // Data is ignored
+			_client (_client&& other, cli_data_t* data) : _base_client(std::move(other)) {}
 		public:
-				// Copy constructor
+				// Copy and move constructors
 			_client (const _client& other) : _base_client(other) {}
+			_client (_client&& other) noexcept : _base_client(std::move(other)) {}
+			_client& operator= (const _client&) = delete;
 #ifndef XIF_NO_THREADS
 				// Constructor from server_thread_data
-			_client (server_thread_data* d) : _client(*((_client*)d->_c)) { delete (_client*)d->_c; delete d; }
+			_client (server_thread_data* d) : _client(std::move(*((_client*)d->_c))) { delete (_client*)d->_c; delete d; }
 #endif
 		};
 		
@@ -153,11 +181,12 @@ namespace socketxx {
 	public:
 		typedef _client<cli_data_t, void> client; // Server's client typedef
 		
-			// List of retained clients. Protected by a mutex.
+			// Retained clients. Sharded registry, thread-safe.
 	protected:
-		std::list<client> retained_clients;
+		client_registry<client> retained_clients;
 	public:
-		typedef typename std::list<client>::iterator client_it;
+		typedef typename client_registry<client>::handle client_it; // Handle of a retained client : `it->` accesses the client, `it.id` is its ID
+		typedef typename client_registry<client>::client_id client_id;
 		
 			// Callbacks
 	public:
@@ -170,12 +199,6 @@ namespace socketxx {
 		
 	protected:
 		
-			// Mutex for protecting methods that are using clients lists
-#ifndef XIF_NO_THREADS
-		pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-		struct _mutex_lock { pthread_mutex_t* const _m; _mutex_lock (pthread_mutex_t& m) : _m(&m) { ::pthread_mutex_lock(_m); } ~_mutex_lock () { ::pthread_mutex_unlock(_m); } };
-#endif
-		
 			// Server listen infos
 		typename socket_base::addr_info listen_addr;
 		bool listening;
@@ -184,6 +207,29 @@ namespace socketxx {
 			// Timeout
 		timeval pool_timeout;
 		
+			// Enable I/O statistics on new clients
+		bool clients_stats_on;
+		
+			// Listening socket shared with other processes
+		bool shared_listener;
+			// Accept a connection, returns false if `try_only` and it was taken by another process; then build its client
+		bool _accept (typename socket_base::_addrt& addr, socket_t& new_fd, bool try_only);
+		client _new_client (socket_t new_fd, typename socket_base::_addrt addr);
+		
+			// Start position of the next scan of wait_client_activity_fair()
+		std::atomic<size_t> fair_pos;
+		
+			// Idle timeouts of retained clients in pool loops. Protected by `idle_m`.
+		timer_wheel idle_timers;                                  // Keyed by client ID
+		uint64_t idle_timeout_ms;                                 // Default timeout, 0 if disabled
+		std::unordered_map<client_id,uint64_t> idle_timeout_cli;  // Per-client timeouts
+		cli_callback_t idle_timeout_f;
+		std::atomic<bool> idle_on;                                // Set once any timeout is used
+		_client_registry::mutex idle_m;
+		uint64_t _idle_timeout_of (client_id id) const { auto f = idle_timeout_cli.find(id); return (f != idle_timeout_cli.end()) ? f->second : idle_timeout_ms; }
+		void _idle_arm (client_id id, uint64_t now)    { uint64_t t = _idle_timeout_of(id); if (t == 0) idle_timers.cancel(id); else idle_timers.set(id, now+t); }
+		void _idle_forget (client_id id)               { if (not idle_on) return; _client_registry::lock _l(idle_m); idle_timers.cancel(id); idle_timeout_cli.erase(id); }
+		
 			// Forbidden constructors
 		socket_server () = delete;
 		socket_server (const socket_server& other) = delete;
@@ -197,6 +243,8 @@ namespace socketxx {
 			auto _addr = listen_addr._getaddr();
 			_addr.use(_addr_use_type_t::SERVER, *this);
 			_socket_server::_server_launch(socket_base::fd, (const sockaddr*)&_addr.addr, _addr.len, listen_max, reuse);
+			if (shared_listener)
+				_socket_server::_server_shared(socket_base::fd, true);
 			listening = true;
 		}
 		void listening_stop () {
@@ -208,26 +256,53 @@ namespace socketxx {
 		
 			// Constructor : set up the server
 			// Take the addr struct for binding, the pending client queue for accepting (SOMAXCONN can be used if defined)
-		socket_server (typename socket_base::addr_info addr, uint listen_max, bool reuse = false) : socket_base(), listen_addr(addr), listening(false), pool_timeout(TIMEOUT_INF) {
+		socket_server (typename socket_base::addr_info addr, uint listen_max, bool reuse = false) : socket_base(), listen_addr(addr), listening(false), pool_timeout(TIMEOUT_INF), clients_stats_on(false), shared_listener(false), fair_pos(0), idle_timers(timer_wheel::now_ms()), idle_timeout_ms(0), idle_timeout_f(nullptr), idle_on(false) {
 			this->listening_start(listen_max, reuse);
 		}
 			// Constructor, without starting listening
-		socket_server (typename socket_base::addr_info addr) : socket_base(), listen_addr(addr), listening(false), pool_timeout(TIMEOUT_INF) {}
+		socket_server (typename socket_base::addr_info addr) : socket_base(), listen_addr(addr), listening(false), pool_timeout(TIMEOUT_INF), clients_stats_on(false), shared_listener(false), fair_pos(0), idle_timers(timer_wheel::now_ms()), idle_timeout_ms(0), idle_timeout_f(nullptr), idle_on(false) {}
 		
 			// Destructor
 		virtual ~socket_server () noexcept { /* no need to call listening_stop, these actions are automatic */ }
 		
-			// Retain client and return iterator.
-		client_it retain_client (client& _client) { _mutex_lock _m(mutex); return retained_clients.insert(retained_clients.end(), _client); }
-			// Release retained client. The client can be copied before to keep the connection opened.
-		void release_client (client_it it)        { _mutex_lock _m(mutex); retained_clients.erase(it); }
+			// Retain client and return its handle. Retaining an already retained client returns its handle.
+		client_it retain_client (const client& _client) { return retained_clients.insert(_client); }
+		client_it retain_client (client&& _client)      { return retained_clients.insert(std::move(_client)); }
+			// Release retained client. The client can be copied before to keep the connection opened. No effect if already released.
+		void release_client (const client_it& it) { retained_clients.erase(it.id); _idle_forget(it.id); }
+		void release_client (client_id id)        { retained_clients.erase(id); _idle_forget(id); }
+		void release_client_fd (fd_t fd)          { client_id id = retained_clients.erase_fd(fd); if (id != 0) _idle_forget(id); }
+			// Lookup of retained clients. Throw `_client_registry::not_found` (std::out_of_range) if not retained.
+		client_it find_client (client_id id) const { return retained_clients.find(id); }
+		client_it find_client_fd (fd_t fd) const  { return retained_clients.find_fd(fd); }
+		bool is_retained (client_id id) const     { return retained_clients.contains(id); }
+		size_t retained_count () const            { return retained_clients.size(); }
+		
+			// Listening socket shared by several processes (see prefork) : accept() is made non-blocking, so a process awaked
+			//  for a client taken by another one goes back waiting. Accepted clients are in blocking mode as usual.
+		void set_shared_listener (bool shared)    { shared_listener = shared; if (listening) _socket_server::_server_shared(socket_base::fd, shared); }
+		bool is_shared_listener () const          { return shared_listener; }
 		
 			// Set pool-timeout, used as maximum wait timeout in pool methods. Null timeout disable it.
 		void set_pool_timeout (timeval timeout)   { pool_timeout = timeout; }
 		
+			// Idle timeout of retained clients in pool loops (wait_activity_loop) : when a client had no activity during `timeout`,
+			//  `timeout_f` is called with it and its timer is re-armed, without disturbing other clients nor the pool-timeout.
+			//  By default (NULL callback), the client is released and the loop rescans. Null timeout or TIMEOUT_INF disables it.
+			//  Precision is 10ms. Changes apply when timers are armed : at rescan, after client activity or timeout.
+		void set_idle_timeout (timeval timeout, cli_callback_t timeout_f = nullptr) { _client_registry::lock _l(idle_m); idle_timeout_ms = _socket_server::_timeout_ms(timeout); idle_timeout_f = timeout_f; idle_on = true; }
+			// Per-client idle timeout (eg. longer for authenticated clients), overriding the default one. Re-arms the client's timer.
+			//  TIMEOUT_INF disables it for this client. Forgotten when the client is released.
+		void set_client_idle_timeout (const client_it& it, timeval timeout)          { _client_registry::lock _l(idle_m); idle_timeout_cli[it.id] = _socket_server::_timeout_ms(timeout); idle_on = true; _idle_arm(it.id, timer_wheel::now_ms()); }
+		
+			// I/O statistics of clients : when enabled, collected for each new client (see base_fd::enable_stats)
+		void set_clients_stats (bool enable)      { clients_stats_on = enable; }
+			// Sum of the statistics of all retained clients
+		io_stats_snapshot clients_stats () const  { std::vector<client_it> v; retained_clients.snapshot(v); io_stats_snapshot s; for (client_it& it : v) s += it->stats_snapshot(); return s; }
+		
 			// Wait for new client, and optionally retain it
 		client wait_new_client ();
-		client_it wait_new_client_retained ()     { _mutex_lock _m(mutex); return retain_client(wait_new_client()); }
+		client_it wait_new_client_retained ()     { return retain_client(wait_new_client()); }
 			// Pool-timeout aware version of wait_new_client. Ignore signals interrupts.
 		client wait_new_client_timeout ()         { chkl(); _socket_server::_select_throw_stop(socket_base::fd, SOCKETXX_INVALID_HANDLE, pool_timeout, true); return wait_new_client(); }
 			// Wait new client and interrupt if reveived changes on a pipe or any file descriptor. Pool-timeout aware. Can ignore signals interrupts.
@@ -237,6 +312,7 @@ namespace socketxx {
 #ifndef XIF_NO_THREADS
 			// Create thread with client
 		inline static pthread_t put_client_threaded (cli_thread_routine_t thread_fnct, const client& cli)     { return _socket_server::_server_cli_new_thread(thread_fnct, new client(cli)); }
+		inline static pthread_t put_client_threaded (cli_thread_routine_t thread_fnct, client&& cli)          { return _socket_server::_server_cli_new_thread(thread_fnct, new client(std::move(cli))); }
 		
 			// Wait for new client and create thread for it
 			// In the new thread, you can get client object with `server<...>::client cli(thread_data)` client constructor
@@ -245,14 +321,16 @@ namespace socketxx {
 #endif
 		
 			// Pool all retained clients and wait for activity. The first awaked client in the list is returned.
-		client_it wait_client_activity ()         { chkl(); _mutex_lock _m(mutex); return this->_wait_client_activity(); }
-			// Fair version : avoid the first client in the list to always be handled before the others, by moving each awaked client to the end of the list. Iterators remain valid.
-		client_it wait_client_activity_fair ()    { chkl(); _mutex_lock _m(mutex); client_it it = this->_wait_client_activity(); retained_clients.splice(retained_clients.end(),retained_clients,it); return it; }
+			// The registry is not locked while waiting : clients retained meanwhile are not monitored, and released ones are skipped.
+		client_it wait_client_activity ()         { return this->_wait_client_activity(false); }
+			// Fair version : avoid the first client in the list to always be handled before the others, by starting each scan after the last awaked client.
+		client_it wait_client_activity_fair ()    { return this->_wait_client_activity(true); }
 		
 			// Pool all retained clients and wait for activity in loop. If activity occurs, `cli_activity()` is called.
 			// Quits if any callback returns `POOL_QUIT`. Timeout exceptions are thrown. Interruptions of syscalls are ignored.
 			// The list of retained clients is scaned only once. To rescan it (eg. after client disconnection), `POOL_RESCAN` can be return from any callback.
-			// Theses methods are not protected by the mutex and therefore only one pool should be used at a time for a socket_server
+			//  Until then, released clients are kept alive and monitored by the loop, new retained clients are not.
+			// Idle clients are handled as set by set_idle_timeout(). Pool-timeout is counted since the last activity, client timeouts excluded.
 		void wait_activity_loop (cli_callback_t cli_activity_f)                                                                                                { _wait_activity_loop<false,false>(cli_activity_f,nullptr,{},nullptr); }
 			// Additonally, wait for new clients. Must be in listening state. `new_client_f` is called with the new client accepted.
 			// New clients are not retained automatically. If the new client is retained, `POOL_RESCAN` can be returned to rescan the list.
@@ -262,13 +340,14 @@ namespace socketxx {
 		void wait_activity_loop (cli_callback_t cli_activity_f, cli_callback_t new_client_f, const std::vector<fd_t>& fds, fd_callback_t fd_activity_f)        { _wait_activity_loop<true,true>(cli_activity_f,new_client_f,fds,fd_activity_f); }
 	
 			// Iterate through the list of retained clients. `POOL_QUIT` can be returned from the callback to abort the iteration.
-		void clients_foreach (cli_callback_t f)   { for (client_it it = retained_clients.begin(); it != retained_clients.end(); ++it) { if (f(*it) == POOL_QUIT) break; }; }
+			// Works on a copy of the list : the callback can retain and release clients.
+		void clients_foreach (cli_callback_t f)   { std::vector<client_it> v; retained_clients.snapshot(v); for (client_it& it : v) { if (f(*it) == POOL_QUIT) break; } }
 		
 			// Pool utility methods
 	protected:
 		template <bool newcli, bool monfds> void _wait_activity_loop (cli_callback_t, cli_callback_t, const std::vector<fd_t>&, fd_callback_t);
-		int clients_fill_fdset (fd_set& s);
-		client_it _wait_client_activity ();
+		static fd_t clients_fill_fdset (const std::vector<client_it>& v, fd_set& s);
+		client_it _wait_client_activity (bool fair);
 	};
 	
 		///--- Implementation ---///
@@ -276,35 +355,54 @@ namespace socketxx {
 	template <typename socket_base, typename D>
 	typename socket_server<socket_base,D>::client socket_server<socket_base,D>::wait_new_client () {
 		chkl();
-		typename socket_base::sockaddr_type addr;
-		socklen_t len = sizeof(addr);
-		socket_t new_fd = _socket_server::_server_accept(socket_base::fd, (sockaddr*)&addr, &len);
-		typename socket_base::_addrt _addr({addr,len});
-		client cli (new_fd, typename socket_base::addr_info(_addr));
-		_addr.use(_addr_use_type_t::SERVER_CLI,cli);
+		typename socket_base::_addrt addr;
+		socket_t new_fd;
+		this->_accept(addr, new_fd, false);
+		return this->_new_client(new_fd, addr);
+	}
+	
+	template <typename socket_base, typename D>
+	bool socket_server<socket_base,D>::_accept (typename socket_base::_addrt& addr, socket_t& new_fd, bool try_only) {
+		addr.len = sizeof(addr.addr);
+		return _socket_server::_server_accept(socket_base::fd, (sockaddr*)&addr.addr, &addr.len, new_fd, shared_listener, try_only);
+	}
+	template <typename socket_base, typename D>
+	typename socket_server<socket_base,D>::client socket_server<socket_base,D>::_new_client (socket_t new_fd, typename socket_base::_addrt addr) {
+		client cli (new_fd, typename socket_base::addr_info(addr));
+		addr.use(_addr_use_type_t::SERVER_CLI,cli);
+		if (clients_stats_on) 
+			cli.enable_stats();
 		return cli;
 	}
 	
 	template <typename socket_base, typename D>
-	int socket_server<socket_base,D>::clients_fill_fdset (fd_set& s) {
+	fd_t socket_server<socket_base,D>::clients_fill_fdset (const std::vector<client_it>& v, fd_set& s) {
 		fd_t max = 0;
 		FD_ZERO(&s);
-		for (client& cli : retained_clients) {
-			FD_SET(cli.fd, &s);
-			if (cli.fd > max)
-				max = cli.fd;
+		for (const client_it& it : v) {
+			FD_SET(it->fd, &s);
+			if (it->fd > max)
+				max = it->fd;
 		}
 		return max;
 	}
 	
 	template <typename socket_base, typename D>
-	typename socket_server<socket_base,D>::client_it socket_server<socket_base,D>::_wait_client_activity () {
-		_mutex_lock _m(mutex);
-		fd_set s;
-		_socket_server::_select(this->clients_fill_fdset(s), &s, pool_timeout);
-		for (client_it it = retained_clients.begin(); it != retained_clients.end(); ++it) 
-			if (FD_ISSET(it->fd, &s)) 
-				return it;
+	typename socket_server<socket_base,D>::client_it socket_server<socket_base,D>::_wait_client_activity (bool fair) {
+		std::vector<client_it> v;
+		for (;;) {
+			retained_clients.snapshot(v);
+			fd_set s;
+			_socket_server::_select(clients_fill_fdset(v, s), &s, pool_timeout);
+			size_t beg = fair ? fair_pos.load() % v.size() : 0;
+			for (size_t k = 0; k < v.size(); k++) {
+				size_t i = (beg + k) % v.size();
+				if (FD_ISSET(v[i]->fd, &s) and retained_clients.contains(v[i].id)) {
+					if (fair) fair_pos = i+1;
+					return v[i];
+				}
+			}
+		}
 	}
 	
 	template <typename socket_base, typename D> template <bool newcli, bool monfds>
@@ -312,8 +410,23 @@ namespace socketxx {
 		if (newcli) chkl();
 		fd_set set;
 		fd_t maxsock;
+		std::vector<client_it> v;
+		std::vector<client_id> expired;
+		std::vector<client_it> expired_cli;
+		cli_callback_t timeout_f;
+		uint64_t now = timer_wheel::now_ms();
+		const uint64_t pool_ms = _socket_server::_timeout_ms(pool_timeout);
+		uint64_t pool_deadline = now + pool_ms;
 	_rescan:
-		maxsock = this->clients_fill_fdset(set);
+		retained_clients.snapshot(v);
+		if (idle_on) {
+			_client_registry::lock _l(idle_m);
+			now = timer_wheel::now_ms();
+			for (client_it& it : v) 
+				if (not idle_timers.armed(it.id)) 
+					this->_idle_arm(it.id, now);
+		}
+		maxsock = clients_fill_fdset(v, set);
 		if (newcli) {
 			FD_SET(socket_base::fd, &set);
 			if (socket_base::fd > maxsock) maxsock = socket_base::fd;
@@ -325,7 +438,26 @@ namespace socketxx {
 			}
 		for (;;) {
 			fd_set cpset = set;
-			_socket_server::_select(maxsock, &cpset, pool_timeout);
+				// Wait up to the pool-timeout, or the next client timeout
+			timeval tm = pool_timeout;
+			bool by_timer = false;
+			if (idle_on) {
+				uint64_t d;
+				{ _client_registry::lock _l(idle_m); d = idle_timers.next_delay(now); }
+				uint64_t pool_left = (pool_timeout == TIMEOUT_INF) ? timer_wheel::no_timer : (pool_deadline > now) ? pool_deadline - now : 0;
+				if (d < pool_left) by_timer = true;
+				else d = pool_left;
+				if (d != timer_wheel::no_timer) tm = timeval({ (time_t)(d/1000), (suseconds_t)(d%1000)*1000 });
+			}
+			uint n_act = 0;
+			try {
+				n_act = _socket_server::_select(maxsock, &cpset, tm);
+			} catch (const socketxx::timeout_event&) {
+				if (not by_timer) throw;
+				FD_ZERO(&cpset);
+			}
+			now = timer_wheel::now_ms();
+			if (n_act != 0) pool_deadline = now + pool_ms;
 			pool_ret_t r = POOL_CONTINUE;
 			if (monfds)
 				for (fd_t fd_monitor : fds) {
@@ -336,16 +468,51 @@ namespace socketxx {
 				}
 			if (newcli)
 				if (FD_ISSET(socket_base::fd, &cpset)) {
-					client new_cli = wait_new_client();
-					r = new_client_f(new_cli);
-					if (r != POOL_CONTINUE) goto _r_check;
+					typename socket_base::_addrt addr;
+					socket_t new_fd;
+					if (this->_accept(addr, new_fd, true)) { // Else taken by another process
+						client new_cli = this->_new_client(new_fd, addr);
+						r = new_client_f(new_cli);
+						if (r != POOL_CONTINUE) goto _r_check;
+					}
 				}
-			for (client_it it = retained_clients.begin(); it != retained_clients.end(); ++it) {
+			for (client_it& it : v) {
 				if (FD_ISSET(it->fd, &cpset)) {
 					r = client_activity_f(*it);
+					if (idle_on and retained_clients.contains(it.id)) { 
+						_client_registry::lock _l(idle_m);
+						this->_idle_arm(it.id, now);
+					}
 					if (r != POOL_CONTINUE) goto _r_check;
 				}
 			}
+				// Idle clients
+			if (idle_on) {
+				expired.clear(); expired_cli.clear();
+				{ _client_registry::lock _l(idle_m); idle_timers.advance(now, expired); timeout_f = idle_timeout_f; }
+				for (client_id id : expired) {
+					{ _client_registry::lock _l(idle_m); if (this->_idle_timeout_of(id) == 0) continue; } // Disabled since armed
+					try { expired_cli.push_back(retained_clients.find(id)); }
+					catch (const std::out_of_range&) { this->_idle_forget(id); }
+				}
+				for (size_t i = 0; i < expired_cli.size(); i++) {
+					client_it& it = expired_cli[i];
+					if (timeout_f == nullptr) {
+						this->release_client(it);
+						r = POOL_RESCAN;
+						continue;
+					}
+					r = timeout_f(*it);
+					_client_registry::lock _l(idle_m);
+					if (retained_clients.contains(it.id)) 
+						this->_idle_arm(it.id, now);
+					if (r != POOL_CONTINUE) {
+						for (size_t j = i+1; j < expired_cli.size(); j++) // Fire again at next wake-up
+							idle_timers.set(expired_cli[j].id, now);
+						goto _r_check;
+					}
+				}
+			}
 		_r_check:
 			if (r == POOL_RESCAN) goto _rescan;
 			if (r == POOL_QUIT) return;
@@ -0,0 +1,150 @@
+#include <socket++/handler/timer_wheel.hpp>
+
+	// OS headers
+#include <time.h>
+
+namespace socketxx { namespace end {
+
+	/************* Timer wheel Implementation *************/
+
+	timer_wheel::timer_wheel (uint64_t now_ms, uint64_t tick_ms) : tick_ms(tick_ms), cur(now_ms / tick_ms) {
+		for (unsigned l = 0; l < levels; l++)
+			occupied[l] = 0;
+	}
+
+	uint64_t timer_wheel::now_ms () {
+		timespec ts;
+		::clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+	}
+
+		// Slot of a timer expiring at `tick` : the lowest level whose range covers it, relative to the current tick
+	timer_wheel::slot_t& timer_wheel::slot_for (uint64_t tick, unsigned& level, unsigned& slot) {
+		const uint64_t range = ((uint64_t)1 << (slot_bits*levels)) - 1;
+		uint64_t t = (tick < cur) ? cur : tick;
+		if (t - cur > range)
+			t = cur + range; // Too far : re-placed when reached
+		uint64_t d = t - cur;
+		level = 0;
+		while (level < levels-1 and d >= (uint64_t)1 << (slot_bits*(level+1)))
+			level++;
+		slot = (unsigned)(t >> (slot_bits*level)) & (slots-1);
+		return wheel[level][slot];
+	}
+
+	void timer_wheel::unlink (slot_t* s) {
+		if (not s->empty())
+			return;
+		size_t i = (size_t)(s - &wheel[0][0]);
+		occupied[i / slots] &= ~((uint64_t)1 << (i % slots));
+	}
+
+	void timer_wheel::place (slot_t& from, slot_t::iterator it) {
+		unsigned l, s;
+		slot_t& to = this->slot_for(it->tick, l, s);
+		to.splice(to.end(), from, it);
+		occupied[l] |= (uint64_t)1 << s;
+		index[it->k] = std::make_pair(it, &to);
+		this->unlink(&from);
+	}
+
+	void timer_wheel::set (key_t k, uint64_t deadline_ms) {
+		uint64_t tick = (deadline_ms + tick_ms - 1) / tick_ms;
+		auto f = index.find(k);
+		if (f != index.end()) {
+			f->second.first->tick = tick;
+			this->place(*f->second.second, f->second.first);
+			return;
+		}
+		unsigned l, s;
+		slot_t& to = this->slot_for(tick, l, s);
+		slot_t::iterator it = to.insert(to.end(), entry({k, tick}));
+		occupied[l] |= (uint64_t)1 << s;
+		index[k] = std::make_pair(it, &to);
+	}
+
+	bool timer_wheel::cancel (key_t k) {
+		auto f = index.find(k);
+		if (f == index.end())
+			return false;
+		slot_t* s = f->second.second;
+		s->erase(f->second.first);
+		index.erase(f);
+		this->unlink(s);
+		return true;
+	}
+
+	void timer_wheel::clear () {
+		for (unsigned l = 0; l < levels; l++) {
+			for (unsigned s = 0; s < slots; s++)
+				wheel[l][s].clear();
+			occupied[l] = 0;
+		}
+		index.clear();
+	}
+
+		// First tick at which a non-empty slot is reached : fired for level 0, moved down for upper levels
+	uint64_t timer_wheel::next_event () const {
+		uint64_t best = no_timer;
+		for (unsigned l = 0; l < levels; l++) {
+			if (occupied[l] == 0)
+				continue;
+			unsigned sh = slot_bits*l;
+			uint64_t base = cur >> sh;
+			if (cur & (((uint64_t)1 << sh) - 1))
+				base++; // Slot of the current window was already moved down
+			unsigned start = (unsigned)base & (slots-1);
+			uint64_t rot = (start == 0) ? occupied[l] : (occupied[l] >> start) | (occupied[l] << (slots-start));
+			uint64_t t = (base + (uint64_t)__builtin_ctzll(rot)) << sh;
+			if (t < best)
+				best = t;
+		}
+		return best;
+	}
+
+	void timer_wheel::process_tick (std::vector<key_t>& expired) {
+			// Move down reached slots of upper levels, highest first
+		for (unsigned l = levels-1; l > 0; l--) {
+			if (cur & (((uint64_t)1 << (slot_bits*l)) - 1))
+				continue;
+			slot_t& sl = wheel[l][(cur >> (slot_bits*l)) & (slots-1)];
+			while (not sl.empty())
+				this->place(sl, sl.begin());
+		}
+			// Fire
+		slot_t& z = wheel[0][cur & (slots-1)];
+		while (not z.empty()) {
+			slot_t::iterator it = z.begin();
+			if (it->tick > cur) { // Deadline beyond the wheel's range
+				this->place(z, it);
+				continue;
+			}
+			expired.push_back(it->k);
+			index.erase(it->k);
+			z.erase(it);
+		}
+		this->unlink(&z);
+		cur++;
+	}
+
+	void timer_wheel::advance (uint64_t now_ms, std::vector<key_t>& expired) {
+		uint64_t target = now_ms / tick_ms;
+		while (not index.empty()) {
+			uint64_t e = this->next_event();
+			if (e > target)
+				break;
+			cur = e; // Skip ticks with nothing to do
+			this->process_tick(expired);
+		}
+		if (cur <= target)
+			cur = target+1;
+	}
+
+	uint64_t timer_wheel::next_delay (uint64_t now_ms) const {
+		if (index.empty())
+			return no_timer;
+		uint64_t t = this->next_event() * tick_ms;
+		return (t > now_ms) ? t - now_ms : 0;
+	}
+
+}}
@@ -0,0 +1,70 @@
+#ifndef SOCKET_XX_HANDLER_TIMER_WHEEL_H
+#define SOCKET_XX_HANDLER_TIMER_WHEEL_H
+
+	// Defs
+#include <socket++/defs.hpp>
+
+	// General headers
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace socketxx { namespace end {
+
+	/***** Hierarchical timer wheel *****
+	 *
+	 *  Timers identified by a key (eg. a client ID), with a deadline in ms on any monotonic clock (see now_ms()).
+	 *  Time is cut in ticks (10ms by default). Level 0 has one slot per tick for the next 64 ticks, level 1 one slot
+	 *   per 64 ticks for the next 64², and so on over 4 levels (~46h with 10ms ticks, longer deadlines are re-placed
+	 *   when reached). A timer is moved down one level when its slot is reached, and fired from level 0.
+	 *  Arming, re-arming and cancelling are O(1). Advancing costs O(1) per fired or moved timer, whatever the elapsed time.
+	 *  Timers never fire early, and at most one tick late. Not thread-safe.
+	 */
+	class timer_wheel {
+	public:
+		typedef uint64_t key_t;
+		static const unsigned levels = 4;
+		static const unsigned slot_bits = 6;
+		static const unsigned slots = 1 << slot_bits;
+		static const uint64_t no_timer = UINT64_MAX;
+
+		timer_wheel (uint64_t now_ms, uint64_t tick_ms = 10);
+		timer_wheel (const timer_wheel&) = delete;
+		timer_wheel& operator= (const timer_wheel&) = delete;
+
+			// Arm the timer `k`, or re-arm it if already armed
+		void set (key_t k, uint64_t deadline_ms);
+			// Disarm the timer `k`. Returns false if not armed
+		bool cancel (key_t k);
+		bool armed (key_t k) const { return index.find(k) != index.end(); }
+		size_t size () const       { return index.size(); }
+		void clear ();
+
+			// Fire timers with deadline up to `now_ms` : their keys are appended to `expired` (by deadline, at tick precision) and disarmed
+		void advance (uint64_t now_ms, std::vector<key_t>& expired);
+			// Time from `now_ms` until the next call to advance() having work to do. `no_timer` if no timer is armed.
+		uint64_t next_delay (uint64_t now_ms) const;
+
+			// CLOCK_MONOTONIC in ms
+		static uint64_t now_ms ();
+
+	private:
+		struct entry { key_t k; uint64_t tick; };
+		typedef std::list<entry> slot_t;
+		slot_t wheel[levels][slots];
+		uint64_t occupied[levels]; // Bitmaps of non-empty slots
+		std::unordered_map<key_t, std::pair<slot_t::iterator,slot_t*>> index;
+		const uint64_t tick_ms;
+		uint64_t cur;              // Next tick to process
+
+		slot_t& slot_for (uint64_t tick, unsigned& level, unsigned& slot);
+		void place (slot_t& from, slot_t::iterator it);
+		uint64_t next_event () const;
+		void process_tick (std::vector<key_t>& expired);
+		void unlink (slot_t* s);
+	};
+
+}}
+
+#endif
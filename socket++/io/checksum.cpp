@@ -0,0 +1,307 @@
+#include <socket++/io/checksum.hpp>
+
+	// General headers
+#include <string.h>
+
+	// CRC32C instructions
+#if defined(__x86_64__)
+	#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+	#include <arm_acle.h>
+#endif
+
+	/// CRC32C (Castagnoli) : hardware instructions when available, table otherwise
+namespace {
+
+	struct crc32c_table_t {
+		uint32_t t[256];
+		crc32c_table_t () {
+			for (uint32_t i = 0; i < 256; i++) {
+				uint32_t c = i;
+				for (uint8_t k = 0; k < 8; k++)
+					c = (c & 1) ? (c >> 1) ^ 0x82F63B78 : (c >> 1);
+				t[i] = c;
+			}
+		}
+	} const crc32c_table;
+
+	uint32_t crc32c_sw (uint32_t crc, const uint8_t* p, size_t len) {
+		while (len--)
+			crc = crc32c_table.t[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+		return crc;
+	}
+
+#if defined(__x86_64__)
+	__attribute__((target("sse4.2"))) uint32_t crc32c_hw (uint32_t crc, const uint8_t* p, size_t len) {
+		uint64_t c = crc;
+		for (; len != 0 and ((uintptr_t)p & 7) != 0; len--)
+			c = _mm_crc32_u8((uint32_t)c, *p++);
+		for (; len >= 8; len -= 8, p += 8)
+			c = _mm_crc32_u64(c, *(const uint64_t*)p);
+		for (; len != 0; len--)
+			c = _mm_crc32_u8((uint32_t)c, *p++);
+		return (uint32_t)c;
+	}
+	bool crc32c_hw_check () { __builtin_cpu_init(); return __builtin_cpu_supports("sse4.2"); }
+	const bool crc32c_hw_ok = crc32c_hw_check();
+#elif defined(__ARM_FEATURE_CRC32)
+	uint32_t crc32c_hw (uint32_t crc, const uint8_t* p, size_t len) {
+		for (; len != 0 and ((uintptr_t)p & 7) != 0; len--)
+			crc = __crc32cb(crc, *p++);
+		for (; len >= 8; len -= 8, p += 8)
+			crc = __crc32cd(crc, *(const uint64_t*)p);
+		for (; len != 0; len--)
+			crc = __crc32cb(crc, *p++);
+		return crc;
+	}
+	const bool crc32c_hw_ok = true;
+#else
+	uint32_t crc32c_hw (uint32_t crc, const uint8_t* p, size_t len) { return crc32c_sw(crc, p, len); }
+	const bool crc32c_hw_ok = false;
+#endif
+
+}
+
+	/// xxHash 64 bits
+namespace {
+
+	const uint64_t XXH_P1 = 0x9E3779B185EBCA87ULL;
+	const uint64_t XXH_P2 = 0xC2B2AE3D27D4EB4FULL;
+	const uint64_t XXH_P3 = 0x165667B19E3779F9ULL;
+	const uint64_t XXH_P4 = 0x85EBCA77C2B2AE63ULL;
+	const uint64_t XXH_P5 = 0x27D4EB2F165667C5ULL;
+
+	inline uint64_t xxh_rotl (uint64_t x, unsigned r) { return (x << r) | (x >> (64 - r)); }
+	inline uint64_t xxh_read64 (const uint8_t* p) {
+		uint64_t v; ::memcpy(&v, p, 8);
+		if (XIF_SOCKETXX_ENDIANNESS == XIF_SOCKETXX_BIG_ENDIAN) v = __builtin_bswap64(v);
+		return v;
+	}
+	inline uint32_t xxh_read32 (const uint8_t* p) {
+		uint32_t v; ::memcpy(&v, p, 4);
+		if (XIF_SOCKETXX_ENDIANNESS == XIF_SOCKETXX_BIG_ENDIAN) v = __builtin_bswap32(v);
+		return v;
+	}
+	inline uint64_t xxh_round (uint64_t acc, uint64_t input) { acc += input * XXH_P2; acc = xxh_rotl(acc, 31); return acc * XXH_P1; }
+	inline uint64_t xxh_merge (uint64_t acc, uint64_t val) { acc ^= xxh_round(0, val); return acc * XXH_P1 + XXH_P4; }
+
+		// Consume 32 bytes stripes, returns the number of bytes consumed
+	size_t xxh_stripes (uint64_t* v, const uint8_t* p, size_t len) {
+		const uint8_t* const beg = p;
+		for (; len >= 32; len -= 32, p += 32) {
+			v[0] = xxh_round(v[0], xxh_read64(p));
+			v[1] = xxh_round(v[1], xxh_read64(p+8));
+			v[2] = xxh_round(v[2], xxh_read64(p+16));
+			v[3] = xxh_round(v[3], xxh_read64(p+24));
+		}
+		return (size_t)(p - beg);
+	}
+
+}
+
+namespace socketxx { namespace io {
+
+	/************* Incremental hash Implementation *************/
+
+	size_t hasher::digest_len (hash_t type) {
+		switch (type) {
+			case HASH_NONE:   return 0;
+			case HASH_MD5:    return 16;
+			case HASH_CRC32C: return 4;
+			case HASH_XXH64:  return 8;
+			default: throw socketxx::error("checksum : unknown hash type");
+		}
+	}
+
+	hasher::hasher (hash_t type) : type(type), failed(false), crc(0xFFFFFFFF) {
+		switch (type) {
+			case HASH_NONE: case HASH_CRC32C: break;
+			case HASH_MD5:
+#ifdef XIF_USE_SSL
+				if (MD5_Init(&md5) != 1)
+					throw socketxx::error("checksum : MD5_Init() failed");
+				break;
+#else
+				throw socketxx::error("checksum : MD5 is not available without OpenSSL");
+#endif
+			case HASH_XXH64:
+				xxh.v[0] = XXH_P1 + XXH_P2;
+				xxh.v[1] = XXH_P2;
+				xxh.v[2] = 0;
+				xxh.v[3] = -XXH_P1;
+				xxh.total_len = 0;
+				xxh.memsz = 0;
+				break;
+			default: throw socketxx::error("checksum : unknown hash type");
+		}
+	}
+
+	void hasher::update (const void* data, size_t len) {
+		const uint8_t* p = (const uint8_t*)data;
+		switch (type) {
+			case HASH_NONE: break;
+#ifdef XIF_USE_SSL
+			case HASH_MD5:
+				if (MD5_Update(&md5, data, len) != 1)
+					failed = true;
+				break;
+#endif
+			case HASH_CRC32C:
+				crc = crc32c_hw_ok ? crc32c_hw(crc, p, len) : crc32c_sw(crc, p, len);
+				break;
+			case HASH_XXH64: {
+				xxh.total_len += len;
+				if (xxh.memsz != 0) { // Complete the pending stripe
+					size_t k = 32 - xxh.memsz;
+					if (len < k) k = len;
+					::memcpy(xxh.mem + xxh.memsz, p, k);
+					xxh.memsz += k; p += k; len -= k;
+					if (xxh.memsz < 32) break;
+					xxh_stripes(xxh.v, xxh.mem, 32);
+					xxh.memsz = 0;
+				}
+				size_t done = xxh_stripes(xxh.v, p, len);
+				::memcpy(xxh.mem, p + done, len - done);
+				xxh.memsz = len - done;
+			} break;
+			default: break;
+		}
+	}
+
+	auto_bdata hasher::final () {
+		size_t len = digest_len(type);
+		if (len == 0)
+			return auto_bdata();
+		if (failed)
+			throw socketxx::error("checksum : hash update failed");
+		auto_bdata d (new unsigned char[len], len, NULL);
+		uint8_t* out = (uint8_t*)d.p;
+		switch (type) {
+#ifdef XIF_USE_SSL
+			case HASH_MD5:
+				if (MD5_Final(out, &md5) != 1)
+					throw socketxx::error("checksum : MD5_Final() failed");
+				break;
+#endif
+			case HASH_CRC32C: {
+				uint32_t c = ~crc;
+				for (uint8_t i = 0; i < 4; i++) out[i] = (uint8_t)(c >> (24 - 8*i));
+			} break;
+			case HASH_XXH64: {
+				uint64_t h;
+				if (xxh.total_len >= 32) {
+					h = xxh_rotl(xxh.v[0], 1) + xxh_rotl(xxh.v[1], 7) + xxh_rotl(xxh.v[2], 12) + xxh_rotl(xxh.v[3], 18);
+					for (uint8_t i = 0; i < 4; i++)
+						h = xxh_merge(h, xxh.v[i]);
+				} else
+					h = XXH_P5; // v[2] is the seed
+				h += xxh.total_len;
+				const uint8_t* p = xxh.mem;
+				size_t rest = xxh.memsz;
+				for (; rest >= 8; rest -= 8, p += 8)
+					h = xxh_rotl(h ^ xxh_round(0, xxh_read64(p)), 27) * XXH_P1 + XXH_P4;
+				if (rest >= 4) {
+					h = xxh_rotl(h ^ ((uint64_t)xxh_read32(p) * XXH_P1), 23) * XXH_P2 + XXH_P3;
+					rest -= 4; p += 4;
+				}
+				for (; rest != 0; rest--, p++)
+					h = xxh_rotl(h ^ (*p * XXH_P5), 11) * XXH_P1;
+				h ^= h >> 33; h *= XXH_P2;
+				h ^= h >> 29; h *= XXH_P3;
+				h ^= h >> 32;
+				for (uint8_t i = 0; i < 8; i++) out[i] = (uint8_t)(h >> (56 - 8*i));
+			} break;
+			default: break;
+		}
+		return d;
+	}
+
+	/************* Pipelined hash Implementation *************/
+
+	pipelined_hasher::pipelined_hasher (hash_t type, bool threaded) : h(type), threaded(threaded and type != HASH_NONE) {
+#ifndef XIF_NO_THREADS
+		job = NULL;
+		job_len = 0;
+		quit = false;
+		if (this->threaded) {
+			::pthread_mutex_init(&mutex, NULL);
+			::pthread_cond_init(&cond, NULL);
+			if (::pthread_create(&thread, NULL, &pipelined_hasher::_worker, this) != 0) { // Hash inline if no thread can be created
+				::pthread_cond_destroy(&cond);
+				::pthread_mutex_destroy(&mutex);
+				this->threaded = false;
+			}
+		}
+#else
+		this->threaded = false;
+#endif
+	}
+
+	pipelined_hasher::~pipelined_hasher () {
+#ifndef XIF_NO_THREADS
+		if (threaded) {
+			::pthread_mutex_lock(&mutex);
+			quit = true;
+			::pthread_cond_broadcast(&cond);
+			::pthread_mutex_unlock(&mutex);
+			::pthread_join(thread, NULL);
+			::pthread_cond_destroy(&cond);
+			::pthread_mutex_destroy(&mutex);
+		}
+#endif
+	}
+
+#ifndef XIF_NO_THREADS
+	void* pipelined_hasher::_worker (void* arg) {
+		pipelined_hasher* self = (pipelined_hasher*)arg;
+		::pthread_mutex_lock(&self->mutex);
+		for (;;) {
+			while (self->job == NULL and not self->quit)
+				::pthread_cond_wait(&self->cond, &self->mutex);
+			if (self->job == NULL) break;
+			const void* data = self->job;
+			size_t len = self->job_len;
+			::pthread_mutex_unlock(&self->mutex);
+			self->h.update(data, len);
+			::pthread_mutex_lock(&self->mutex);
+			self->job = NULL;
+			::pthread_cond_broadcast(&self->cond);
+		}
+		::pthread_mutex_unlock(&self->mutex);
+		return NULL;
+	}
+#endif
+
+	void pipelined_hasher::wait () {
+#ifndef XIF_NO_THREADS
+		if (not threaded) return;
+		::pthread_mutex_lock(&mutex);
+		while (job != NULL)
+			::pthread_cond_wait(&cond, &mutex);
+		::pthread_mutex_unlock(&mutex);
+#endif
+	}
+
+	void pipelined_hasher::submit (const void* data, size_t len) {
+		if (len == 0) return;
+		if (not threaded) {
+			h.update(data, len);
+			return;
+		}
+#ifndef XIF_NO_THREADS
+		::pthread_mutex_lock(&mutex);
+		while (job != NULL)
+			::pthread_cond_wait(&cond, &mutex);
+		job = data;
+		job_len = len;
+		::pthread_cond_broadcast(&cond);
+		::pthread_mutex_unlock(&mutex);
+#endif
+	}
+
+	auto_bdata pipelined_hasher::final () {
+		this->wait();
+		return h.final();
+	}
+
+}}
@@ -0,0 +1,87 @@
+#ifndef SOCKET_XX_CHECKSUM_H
+#define SOCKET_XX_CHECKSUM_H
+
+	// Defs
+#include <socket++/defs.hpp>
+
+	// General
+#include <inttypes.h>
+
+	// OpenSSL (MD5)
+#ifdef XIF_USE_SSL
+	#include <openssl/md5.h>
+#endif
+
+	// Threads
+#ifndef XIF_NO_THREADS
+	#include <pthread.h>
+#endif
+
+namespace socketxx { namespace io {
+
+		// Integrity hash algorithms for file transfers. Both sides must use the same one.
+	enum hash_t {
+		HASH_NONE = 0,
+		HASH_MD5,     // OpenSSL builds only. Compatible with older socket++ versions
+		HASH_CRC32C,  // Castagnoli CRC, with SSE4.2 or ARMv8 CRC instructions when available
+		HASH_XXH64,   // xxHash 64 bits, seed 0
+#ifdef XIF_USE_SSL
+		HASH_DEFAULT = HASH_MD5
+#else
+		HASH_DEFAULT = HASH_NONE
+#endif
+	};
+
+	/***** Incremental hash *****
+	 *  Digests are returned in canonical (big-endian) byte order, NULL for HASH_NONE.
+	 */
+	class hasher {
+	protected:
+		hash_t type;
+		bool failed;
+#ifdef XIF_USE_SSL
+		MD5_CTX md5;
+#endif
+		uint32_t crc;
+		struct xxh64_state {
+			uint64_t v[4];
+			uint64_t total_len;
+			uint8_t mem[32];
+			size_t memsz;
+		} xxh;
+	public:
+		hasher (hash_t type);
+		void update (const void* data, size_t len);
+		auto_bdata final (); // Call only once
+		static size_t digest_len (hash_t type);
+	};
+
+	/***** Pipelined hash *****
+	 *  Hashes buffers on a separate thread while the caller is doing I/O.
+	 *  A submitted buffer must stay valid and unmodified until the next call to wait(), submit() or final().
+	 *  Without threads (or if `threaded` is false), buffers are hashed directly by submit().
+	 */
+	class pipelined_hasher {
+		hasher h;
+		bool threaded;
+#ifndef XIF_NO_THREADS
+		pthread_t thread;
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+		const void* job;
+		size_t job_len;
+		bool quit;
+		static void* _worker (void*);
+#endif
+	public:
+		pipelined_hasher (hash_t type, bool threaded);
+		pipelined_hasher (const pipelined_hasher&) = delete;
+		~pipelined_hasher ();
+		void submit (const void* data, size_t len); // Waits for the previous buffer to be hashed
+		void wait ();                               // Waits for the current buffer to be hashed
+		auto_bdata final ();
+	};
+
+}}
+
+#endif
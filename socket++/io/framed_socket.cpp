@@ -0,0 +1,87 @@
+#include <socket++/io/framed_socket.hpp>
+
+	// OS headers
+#include <sys/socket.h>
+#include <poll.h>
+#include <limits.h>
+#include <errno.h>
+
+	// Swapping of simple_socket
+#include <socket++/io/simple_socket.hpp>
+
+namespace socketxx { namespace io { namespace _framed_socket {
+
+	const socketxx::error frame_too_big ("framed_socket : frame bigger than the maximum frame size");
+
+	uint32_t get_len (const char* p) {
+		uint32_t len;
+		::memcpy(&len, p, hdr_sz);
+		if (not XIF_SOCKETXX_ENDIANNESS_SAME) _simple_socket::swapBytes(&len, hdr_sz);
+		return len;
+	}
+	void put_len (char* p, uint32_t len) {
+		if (not XIF_SOCKETXX_ENDIANNESS_SAME) _simple_socket::swapBytes(&len, hdr_sz);
+		::memcpy(p, &len, hdr_sz);
+	}
+
+	void fill (socketxx::base_fd& sock, i_fnct readf, std::vector<char>& buf, size_t& beg, size_t& end, size_t need) {
+		if (buf.size() - beg < need) {
+				// Move pending bytes at the start
+			if (beg != end) ::memmove(&buf[0], &buf[beg], end-beg);
+			end -= beg;
+			beg = 0;
+			if (buf.size() < need)
+				buf.resize(need);
+		}
+		while (end - beg < need)
+			end += (sock.*readf)(&buf[end], buf.size()-end);
+	}
+
+	void write_vec (fd_t fd, iovec* v, size_t n, bool sock, bool poll_mode, uint64_t deadline, io_stats* st) {
+	#ifdef IOV_MAX
+		const size_t iov_max = IOV_MAX;
+	#else
+		const size_t iov_max = 1024;
+	#endif
+		_io_stats::timer tm (st);
+		size_t len = 0;
+		for (size_t i = 0; i < n; i++)
+			len += v[i].iov_len;
+		while (n != 0 and v->iov_len == 0) { v++; n--; }
+		while (n != 0) {
+			if (poll_mode and not sock) {
+				try {
+					_base_fd::_poll_wait(fd, POLLOUT, deadline, io_error::WRITE);
+				} catch (...) { tm.write(-1); throw; }
+			}
+			size_t k = (n < iov_max) ? n : iov_max;
+			ssize_t r;
+			if (sock) {
+				msghdr h;
+				::memset(&h, 0, sizeof(h));
+				h.msg_iov = v;
+				h.msg_iovlen = k;
+				r = ::sendmsg(fd, &h, MSG_NOSIGNAL | (poll_mode ? MSG_DONTWAIT : 0));
+			} else
+				r = ::writev(fd, v, (int)k);
+			if (r == -1 and errno == EINTR) continue;
+			if (r == -1 and sock and poll_mode and (errno == EAGAIN or errno == EWOULDBLOCK)) {
+				try {
+					_base_fd::_poll_wait(fd, POLLOUT, deadline, io_error::WRITE);
+				} catch (...) { tm.write(-1); throw; }
+				continue;
+			}
+			tm.write(r);
+			if (r < 1) throw socketxx::io_error(r, io_error::WRITE);
+			len -= (size_t)r;
+				// Skip what was written
+			size_t w = (size_t)r;
+			while (n != 0 and w >= v->iov_len) { w -= v->iov_len; v++; n--; }
+			if (n != 0) {
+				v->iov_base = (char*)v->iov_base + w;
+				v->iov_len -= w;
+			}
+		}
+	}
+
+}}}
@@ -0,0 +1,188 @@
+#ifndef SOCKET_XX_FRAMED_SOCKET_H
+#define SOCKET_XX_FRAMED_SOCKET_H
+
+	// BaseIO
+#include <socket++/base_io.hpp>
+
+	// General
+#include <inttypes.h>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <string.h>
+
+	// OS headers
+#include <sys/uio.h>
+
+namespace socketxx { namespace io {
+
+		// Private external functions
+	namespace _framed_socket {
+
+		typedef size_t (socketxx::base_fd::* i_fnct) (void *, size_t);
+
+			// Frame bigger than the maximum frame size
+		extern const socketxx::error frame_too_big;
+
+		const size_t hdr_sz = sizeof(uint32_t);
+		const size_t rbuf_init_sz = 64*1024;
+
+			// Length prefix, in the byte order of simple_socket's integers
+		uint32_t get_len (const char* p);
+		void put_len (char* p, uint32_t len);
+
+			// Read until at least `need` bytes are buffered from `beg`, moving the pending bytes at the start of the buffer or growing it if needed.
+			//  Reads as much as available : following frames are read ahead.
+		void fill (socketxx::base_fd& sock, i_fnct readf, std::vector<char>& buf, size_t& beg, size_t& end, size_t need);
+
+			// Gathered write of `n` buffers, with writev() or sendmsg() on sockets. Partial writes are completed.
+		void write_vec (fd_t fd, iovec* v, size_t n, bool sock, bool poll_mode, uint64_t deadline, io_stats* st);
+
+	}
+
+		// Enabling framed_socket<io_base> only for socketxx::base_fd derivatives
+	template <typename io_base, typename = typename std::enable_if<std::is_base_of<socketxx::base_fd, io_base>::value>::type>
+		class framed_socket;
+
+	/***** Framed Socket type I/O class *****
+	 *
+	 *  Message-oriented : each frame is a 32 bits length followed by the data, a base for binary RPC protocols.
+	 *  Frames are received in a buffer reused from one frame to another, and read ahead : a burst of small frames
+	 *   costs one read. i_frame() returns a view of the frame in this buffer, without copy, valid until the next read.
+	 *   The buffer grows to the biggest frame received.
+	 *  Frames bigger than the maximum frame size (16MiB by default) are rejected on both sides with `frame_too_big` :
+	 *   a peer can't make us allocate more. After such an error on reception, the stream is not usable anymore.
+	 *  A frame is sent in one writev()/sendmsg() with its length prefix, gathered from one or many buffers, when the
+	 *   BaseIO writes unmodified data to the fd. Otherwise (TLS, compression...) the frame is copied in one buffer and
+	 *   written at once.
+	 *  The wire format is the same as simple_socket's o_bin()/i_bin(), with the same byte order.
+	 *  As data is read ahead, reading the socket by other means after i_frame() loses data, and select() on the socket
+	 *   does not see frames already buffered : check frame_ready() first.
+	 */
+	template <typename io_base>
+	class framed_socket<io_base> : public io_base {
+	public:
+
+			// View of a received frame, valid until the next read
+		struct frame {
+			const char* data;
+			size_t len;
+			std::string str () const { return std::string(data, len); }
+		};
+
+	protected:
+
+			// Private relay constructors
+		framed_socket (bool autoclose_handle, socket_t handle) : io_base(autoclose_handle, handle), max_frame(default_max_frame), rbeg(0), rend(0) {}
+		framed_socket () : io_base(), max_frame(default_max_frame), rbeg(0), rend(0) {}
+
+			// Maximum frame size
+		uint32_t max_frame;
+			// Read buffer, with the pending bytes between `rbeg` and `rend`
+		std::vector<char> rbuf;
+		size_t rbeg, rend;
+			// Copy buffer for non-raw BaseIOs
+		std::vector<char> wbuf;
+
+			// Gathered write
+		bool _poll_mode (std::true_type) const  { return this->_wait_mode(); }
+		bool _poll_mode (std::false_type) const { return this->shd->deadline != 0; }
+		void _o_frame (iovec* v, size_t n, size_t len);
+
+	public:
+
+		static const uint32_t default_max_frame = 16*1024*1024;
+
+			// Copy constructor : pending bytes are copied
+		framed_socket (const framed_socket<io_base>& other) : io_base(other), max_frame(other.max_frame), rbuf(other.rbuf.begin()+other.rbeg, other.rbuf.begin()+other.rend), rbeg(0), rend(other.rend-other.rbeg) {}
+			// Move constructor
+		framed_socket (framed_socket<io_base>&& other) noexcept : io_base(std::move(other)), max_frame(other.max_frame), rbuf(std::move(other.rbuf)), rbeg(other.rbeg), rend(other.rend), wbuf(std::move(other.wbuf)) { other.rbeg = other.rend = 0; }
+			// Construct from an io_base object
+		framed_socket (const io_base& iob) : io_base(iob), max_frame(default_max_frame), rbeg(0), rend(0) {}
+
+			// Maximum frame size, for reception and sending. Modifications do not spread across copies.
+		void set_max_frame (uint32_t max) { max_frame = max; }
+		uint32_t get_max_frame () const   { return max_frame; }
+
+	public:
+
+			// Receive a frame
+		frame i_frame ();
+			// A complete frame is already buffered : i_frame() won't read the socket
+		bool frame_ready () const;
+			// Bytes read ahead, not returned yet
+		size_t i_buffered () const { return rend - rbeg; }
+
+			// Send a frame
+		void o_frame (const void* data, size_t len)     { iovec v[2]; v[1].iov_base = const_cast<void*>(data); v[1].iov_len = len; this->_o_frame(v, 2, len); }
+		void o_frame (const std::string& str)           { this->o_frame(str.data(), str.length()); }
+			// Send one frame made of `n` parts (eg. a header and a payload), without joining them first
+		void o_frame (const iovec* parts, size_t n);
+
+	};
+
+		///--- Implementation ---///
+
+	template <typename io_base>
+	typename framed_socket<io_base>::frame framed_socket<io_base>::i_frame () {
+		if (rend - rbeg < _framed_socket::hdr_sz) {
+			if (rbuf.empty()) rbuf.resize(_framed_socket::rbuf_init_sz);
+			_framed_socket::fill(*this, this->_get_io_fncts().i, rbuf, rbeg, rend, _framed_socket::hdr_sz);
+		}
+		uint32_t len = _framed_socket::get_len(&rbuf[rbeg]);
+		if (len > max_frame)
+			throw _framed_socket::frame_too_big;
+		if (rend - rbeg < _framed_socket::hdr_sz + len)
+			_framed_socket::fill(*this, this->_get_io_fncts().i, rbuf, rbeg, rend, _framed_socket::hdr_sz + len);
+		frame f = { &rbuf[rbeg + _framed_socket::hdr_sz], len };
+		rbeg += _framed_socket::hdr_sz + len;
+		if (rbeg == rend)
+			rbeg = rend = 0;
+		return f;
+	}
+
+	template <typename io_base>
+	bool framed_socket<io_base>::frame_ready () const {
+		if (rend - rbeg < _framed_socket::hdr_sz)
+			return false;
+		return rend - rbeg >= _framed_socket::hdr_sz + _framed_socket::get_len(&rbuf[rbeg]);
+	}
+
+	template <typename io_base>
+	void framed_socket<io_base>::o_frame (const iovec* parts, size_t n) {
+		std::vector<iovec> v (n+1);
+		size_t len = 0;
+		for (size_t i = 0; i < n; i++) {
+			v[i+1] = parts[i];
+			len += parts[i].iov_len;
+		}
+		this->_o_frame(v.data(), n+1, len);
+	}
+
+		// `v[0]` is reserved for the length prefix
+	template <typename io_base>
+	void framed_socket<io_base>::_o_frame (iovec* v, size_t n, size_t len) {
+		if (len > max_frame)
+			throw _framed_socket::frame_too_big;
+		char hdr[_framed_socket::hdr_sz];
+		_framed_socket::put_len(hdr, (uint32_t)len);
+		if (this->_get_io_fncts().raw) {
+			v[0].iov_base = hdr;
+			v[0].iov_len = _framed_socket::hdr_sz;
+			_framed_socket::write_vec(this->fd, v, n, std::is_base_of<socketxx::base_socket, io_base>::value,
+			                          this->_poll_mode(std::is_base_of<socketxx::base_socket, io_base>()), this->shd->deadline, this->shd->stats);
+		} else {
+			wbuf.resize(_framed_socket::hdr_sz + len);
+			::memcpy(&wbuf[0], hdr, _framed_socket::hdr_sz);
+			size_t p = _framed_socket::hdr_sz;
+			for (size_t i = 1; i < n; i++) {
+				if (v[i].iov_len != 0) ::memcpy(&wbuf[p], v[i].iov_base, v[i].iov_len);
+				p += v[i].iov_len;
+			}
+			(this->*(this->_get_io_fncts().o))(wbuf.data(), wbuf.size());
+		}
+	}
+
+}}
+
+#endif
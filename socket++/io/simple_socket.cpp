@@ -2,15 +2,20 @@
 
 	// OS headers
 #include <sys/mman.h>
-#ifdef XIF_USE_SSL
-	#include <openssl/md5.h>
-#endif
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <string.h>
+#include <sys/socket.h>
 
 	/// Swap bytes when foreign host have not the same endianness
 void socketxx::io::_simple_socket::swapBytes(void* data_to_swap, size_t size) { // use bswap instructions
+	switch (size) {
+		case 1: return;
+		case 2: { uint16_t v; ::memcpy(&v, data_to_swap, 2); v = __builtin_bswap16(v); ::memcpy(data_to_swap, &v, 2); return; }
+		case 4: { uint32_t v; ::memcpy(&v, data_to_swap, 4); v = __builtin_bswap32(v); ::memcpy(data_to_swap, &v, 4); return; }
+		case 8: { uint64_t v; ::memcpy(&v, data_to_swap, 8); v = __builtin_bswap64(v); ::memcpy(data_to_swap, &v, 8); return; }
+	}
 	uint8_t* data = (uint8_t*)data_to_swap;
 	uint8_t tmp;
 	for (size_t i = 0; i < size/2; ++i) {
@@ -19,6 +24,210 @@ void socketxx::io::_simple_socket::swapBytes(void* data_to_swap, size_t size) {
 		data[size-1-i] = tmp;
 	}
 }
+	/// Swap bytes of each element of an array. Plain bswap loops, vectorized by the compiler (pshufb, rev...)
+void socketxx::io::_simple_socket::swapBytesArray (void* array, size_t elsize, size_t count) {
+	uint8_t* p = (uint8_t*)array;
+	switch (elsize) {
+		case 1: return;
+		case 2: for (size_t i = 0; i < count; i++, p += 2) { uint16_t v; ::memcpy(&v, p, 2); v = __builtin_bswap16(v); ::memcpy(p, &v, 2); } return;
+		case 4: for (size_t i = 0; i < count; i++, p += 4) { uint32_t v; ::memcpy(&v, p, 4); v = __builtin_bswap32(v); ::memcpy(p, &v, 4); } return;
+		case 8: for (size_t i = 0; i < count; i++, p += 8) { uint64_t v; ::memcpy(&v, p, 8); v = __builtin_bswap64(v); ::memcpy(p, &v, 8); } return;
+	}
+	for (size_t i = 0; i < count; i++, p += elsize) 
+		swapBytes(p, elsize);
+}
+
+	/// Compact integers : LEB128 encoding
+size_t socketxx::io::_simple_socket::varint_encode (uint64_t n, uint8_t* buf) {
+	size_t i = 0;
+	while (n >= 0x80) {
+		buf[i++] = (uint8_t)n | 0x80;
+		n >>= 7;
+	}
+	buf[i++] = (uint8_t)n;
+	return i;
+}
+const socketxx::error socketxx::io::_simple_socket::bad_varint ("simple_socket : malformed compact integer");
+size_t socketxx::io::_simple_socket::varint_decode (const uint8_t* p, size_t avail, uint64_t& n) {
+	n = 0;
+	for (size_t i = 0; i < avail; i++) {
+		if (i == varint_maxsz-1 and p[i] > 0x01) // 10th byte holds the 64th bit only
+			throw bad_varint;
+		n |= (uint64_t)(p[i] & 0x7F) << (7*i);
+		if (p[i] < 0x80) 
+			return i+1;
+	}
+	if (avail >= varint_maxsz) 
+		throw bad_varint;
+	return 0;
+}
+size_t socketxx::io::_simple_socket::peek_sock (fd_t fd, void* buf, size_t len) {
+	ssize_t r = ::recv(fd, buf, len, MSG_PEEK | MSG_DONTWAIT);
+	return (r > 0) ? (size_t)r : 0;
+}
+
+	/// Polyvar serialization, with the same format as the o_* methods
+size_t socketxx::io::_simple_socket::var_size (const xif::polyvar& p, bool compact) {
+	using namespace xif;
+	size_t sz = 1;
+	switch (p.type()) {
+		case polyvar::VOID:                           break;
+		case polyvar::STR:   sz += (compact ? varint_size(p.s().length()) : (p.s().length() > 254 ? 9 : 1)) + p.s().length(); break;
+		case polyvar::FLOAT: sz += 8;                 break;
+		case polyvar::INT:   sz += (compact ? varint_size(zigzag_enc<int64_t>(p.i())) : 8); break;
+		case polyvar::CHAR:  sz += 1;                 break;
+		case polyvar::BOOL:  sz += 1;                 break;
+		case polyvar::LIST: {
+			const std::vector<xif::polyvar>& v = p.v();
+			sz += (compact ? varint_size(v.size()) : 8);
+			for (size_t i = 0; i < v.size(); i++) 
+				sz += var_size(v[i], compact);
+		} break;
+		case polyvar::MAP: {
+			const std::map<std::string,xif::polyvar>& m = p.m();
+			sz += (compact ? varint_size(m.size()) : 8);
+			for (auto it = m.begin(); it != m.end(); it++) 
+				sz += (compact ? varint_size(it->first.length()) : (it->first.length() > 254 ? 9 : 1)) + it->first.length() + var_size(it->second, compact);
+		} break;
+	}
+	return sz;
+}
+uint8_t* socketxx::io::_simple_socket::var_put (uint8_t* b, const xif::polyvar& p, bool compact) {
+	using namespace xif;
+	*b++ = (uint8_t)p.type();
+	switch (p.type()) {
+		case polyvar::VOID:                                                          break;
+		case polyvar::STR:   b = msg_field<std::string>::put(b, p.s(), compact);    break;
+		case polyvar::FLOAT: b = msg_field<double>::put(b, p.f(), compact);         break;
+		case polyvar::INT:   b = msg_field<int64_t>::put(b, p.i(), compact);        break;
+		case polyvar::CHAR:  b = msg_field<char>::put(b, p.c(), compact);           break;
+		case polyvar::BOOL:  b = msg_field<bool>::put(b, p.b(), compact);           break;
+		case polyvar::LIST: {
+			const std::vector<xif::polyvar>& v = p.v();
+			b = msg_field<uint64_t>::put(b, v.size(), compact);
+			for (size_t i = 0; i < v.size(); i++) 
+				b = var_put(b, v[i], compact);
+		} break;
+		case polyvar::MAP: {
+			const std::map<std::string,xif::polyvar>& m = p.m();
+			b = msg_field<uint64_t>::put(b, m.size(), compact);
+			for (auto it = m.begin(); it != m.end(); it++) {
+				b = msg_field<std::string>::put(b, it->first, compact);
+				b = var_put(b, it->second, compact);
+			}
+		} break;
+	}
+	return b;
+}
+
+	/// Polyvar reading. Each read asks for the needed bytes plus the bytes the rest of the polyvar is guaranteed to 
+	///  contain (`after`) : one byte per remaining list element, two per remaining map entry. Nothing is read past the polyvar.
+namespace {
+	using namespace socketxx::io::_simple_socket;
+	
+	struct var_reader {
+		static const size_t fetch_max = 256*1024;
+		socketxx::base_fd& s;
+		socketxx::base_fd::_io_fncts::i_fnct i;
+		bool compact;
+		uint8_t* buf;
+		size_t cap, beg, end;
+		var_reader (socketxx::base_fd& s, socketxx::base_fd::_io_fncts::i_fnct i, bool compact) : s(s), i(i), compact(compact), buf(NULL), cap(0), beg(0), end(0) {}
+		~var_reader () { delete[] buf; }
+		
+			// Ensure that `k` bytes are buffered, knowing that at least `after` bytes follow them
+		void need (size_t k, size_t after) {
+			size_t avail = end - beg;
+			if (avail >= k) return;
+			size_t want = k + ((after < fetch_max) ? after : fetch_max);
+			if (want > cap) {
+				uint8_t* nbuf = new uint8_t[want];
+				::memcpy(nbuf, buf+beg, avail);
+				delete[] buf;
+				buf = nbuf;
+				cap = want;
+			} else if (beg != 0) 
+				::memmove(buf, buf+beg, avail);
+			beg = 0;
+			end = avail;
+			while (end < k) 
+				end += (s.*i)(buf+end, want-end);
+		}
+		uint8_t get_byte (size_t after) { need(1, after); return buf[beg++]; }
+		template <typename int_t> int_t get_int (size_t after, bool fixed = false) {
+			if (compact and not fixed) {
+				uint8_t v[varint_maxsz];
+				uint64_t n;
+				for (size_t k = 0; k < varint_maxsz; k++) {
+					v[k] = get_byte(after);
+					if (v[k] < 0x80) {
+						varint_decode(v, k+1, n);
+						return varint_to<int_t>(n);
+					}
+				}
+				throw bad_varint;
+			}
+			need(sizeof(int_t), after);
+			beg += sizeof(int_t);
+			return msg_field<int_t>::get(buf+beg-sizeof(int_t));
+		}
+		std::string get_str (size_t after) {
+			uint64_t len;
+			if (compact) len = get_int<uint64_t>(after);
+			else {
+				len = get_byte(after);
+				if (len == 255) len = get_int<uint64_t>(after);
+			}
+			if (len <= fetch_max) {
+				need(len, after);
+				beg += len;
+				return std::string((const char*)buf+beg-len, len);
+			}
+			std::string str (len, '\0'); // Big string : read directly in its storage
+			size_t avail = end - beg;
+			::memcpy(&str[0], buf+beg, avail);
+			beg = end = 0;
+			for (size_t done = avail; done < len;) 
+				done += (s.*i)(&str[done], len-done);
+			return str;
+		}
+		xif::polyvar get_var (size_t after) {
+			using namespace xif;
+			enum xif::polyvar::type t = (enum xif::polyvar::type)get_byte(after);
+			switch (t) {
+				case polyvar::VOID:  return xif::polyvar( );
+				case polyvar::STR:   return xif::polyvar( get_str(after) );
+				case polyvar::FLOAT: { int64_t f = get_int<int64_t>(after, true); return xif::polyvar( *((double*)&f) ); }
+				case polyvar::INT:   return xif::polyvar( get_int<int64_t>(after) );
+				case polyvar::CHAR:  return xif::polyvar( (char)get_byte(after) );
+				case polyvar::BOOL:  return xif::polyvar( (bool)get_byte(after) );
+				case polyvar::LIST: {
+					uint64_t n = get_int<uint64_t>(after);
+					xif::polyvar p = std::vector<xif::polyvar>( n );
+					for (uint64_t k = 0; k < n; k++) 
+						p.v()[k] = get_var(after + (n-1-k));
+					return p;
+				}
+				case polyvar::MAP: {
+					xif::polyvar p = std::map<std::string,xif::polyvar>();
+					uint64_t n = get_int<uint64_t>(after);
+					for (uint64_t k = 0; k < n; k++) {
+						std::string key = get_str(after + 1 + 2*(n-1-k));
+						xif::polyvar val = get_var(after + 2*(n-1-k));
+						p.m().insert( std::pair<std::string,xif::polyvar>(key, val) );
+					}
+					return p;
+				}
+			}
+			throw socketxx::error("simple_socket : bad polyvar type");
+		}
+	};
+	
+}
+xif::polyvar socketxx::io::_simple_socket::read_var (socketxx::base_fd& s, base_fd::_io_fncts::i_fnct i, bool compact) {
+	var_reader rd (s, i, compact);
+	return rd.get_var(0);
+}
 
 	/// Duplicate file descriptor for sending sock
 fd_t socketxx::io::_simple_socket::dup_fd (fd_t orig_fd) {
@@ -64,74 +273,107 @@ size_t socketxx::io::_simple_socket::open_file_read (fd_t& filefd, const char* p
 	return sz;
 }
 
-	/// Read from socket and write to file, with classical copy to userspace
-unsigned char* socketxx::io::_simple_socket::read_to_file (socketxx::base_fd& s, base_fd::_io_fncts::i_fnct i, base_fd::_io_fncts::o_fnct o, fd_t file_w, size_t sz, _simple_socket::trsf_info_f info_f) {
-	if (sz == 0) return NULL;
-	int r;
-#ifdef XIF_USE_SSL
-	MD5_CTX hashctx; MD5_Init(&hashctx);
+	/// File reception helpers
+namespace {
+	void write_all (fd_t file_w, const char* b, size_t len) {
+		while (len != 0) {
+			ssize_t rs = ::write(file_w, b, len);
+			if (rs < 1) 
+				throw socketxx::other_error("read_to_file : failed to write to file");
+			b += rs;
+			len -= (size_t)rs;
+		}
+	}
+	
+#ifdef HAVE_SPLICE
+		/// Move data from fd to file in kernel : fd → pipe → file with splice(), no copy to userspace. 
+		///  Returns the size moved : stops if splice() is not supported for this fd (nothing is read then), or when a
+		///  non-blocking fd (pipe read timeout, deadline on a copy...) has no data, as splice() can't wait for it.
+	size_t splice_to_file (fd_t fd, fd_t file_w, size_t sz, socketxx::io::_simple_socket::trsf_info_f info_f, socketxx::io_stats* st) {
+		struct pipe_fds {
+			fd_t p[2];
+			pipe_fds () { if (::pipe(p) == -1) throw socketxx::other_error("read_to_file : pipe() failed"); }
+			~pipe_fds () { ::close(p[0]); ::close(p[1]); }
+		} pipe;
+		size_t pipesz = 1024*1024;
+	#ifdef F_SETPIPE_SZ
+		int r = ::fcntl(pipe.p[1], F_SETPIPE_SZ, (int)pipesz);
+		if (r == -1) pipesz = (size_t)::getpagesize() * 16; // Default pipe capacity
+		else pipesz = (size_t)r;
+	#else
+		pipesz = (size_t)::getpagesize() * 16;
+	#endif
+		size_t bytes_rest = sz;
+		while (bytes_rest != 0) {
+			socketxx::_io_stats::timer tm (st);
+			ssize_t rs = ::splice(fd, NULL, pipe.p[1], NULL, (bytes_rest < pipesz) ? bytes_rest : pipesz, SPLICE_F_MOVE|SPLICE_F_MORE);
+			if (rs == -1 and errno == EINTR) continue;
+			if (rs == -1 and errno == EINVAL and bytes_rest == sz) 
+				return 0;
+			if (rs == -1 and (errno == EAGAIN or errno == EWOULDBLOCK) and (::fcntl(fd, F_GETFL) & O_NONBLOCK)) // Else SO_RCVTIMEO expired
+				return sz - bytes_rest;
+			tm.read(rs);
+			if (rs < 1) 
+				throw socketxx::io_error(rs, socketxx::io_error::READ);
+			bytes_rest -= (size_t)rs;
+			for (size_t in_pipe = (size_t)rs; in_pipe != 0;) {
+				ssize_t ws = ::splice(pipe.p[0], NULL, file_w, NULL, in_pipe, SPLICE_F_MOVE|SPLICE_F_MORE);
+				if (ws == -1 and errno == EINTR) continue;
+				if (ws < 1) 
+					throw socketxx::other_error("read_to_file : failed to splice to file");
+				in_pipe -= (size_t)ws;
+			}
+			if (info_f)
+				info_f (sz-bytes_rest, sz);
+		}
+		return sz;
+	}
+#endif
+}
+
+	/// Read from socket and write to file. Moved in kernel with splice() if the BaseIO is raw and without hash, 
+	///  with classical copy to userspace otherwise : two buffers are used in turn : one is hashed by the hash thread while the other is received.
+	///  What splice() can't move (non-blocking fd without data) is read with the BaseIO routines, which wait with its timeouts.
+socketxx::auto_bdata socketxx::io::_simple_socket::read_to_file (socketxx::base_fd& s, base_fd::_io_fncts::i_fnct i, base_fd::_io_fncts::o_fnct o, bool raw, fd_t file_w, size_t sz, _simple_socket::trsf_info_f info_f, hash_t hash) {
+	if (sz == 0) return auto_bdata();
+#ifdef HAVE_FALLOCATE
+	::fallocate(file_w, 0, 0, (off_t)sz); // Preallocation is only an optimization : errors are ignored
+#endif
+	::lseek(file_w, 0, SEEK_SET);
+	size_t bytes_rest = sz;
+#ifdef HAVE_SPLICE
+	if (raw and hash == HASH_NONE and not s.has_deadline()) { // splice() can't be bounded by the deadline
+		bytes_rest -= splice_to_file(s.get_fd(), file_w, sz, info_f, s.get_stats());
+		if (bytes_rest == 0)
+			return auto_bdata();
+	}
 #endif
 	size_t chunksz = (size_t)::getpagesize() * 16;
 	struct buffer {
-		void* b;
-		buffer (size_t chunksz) : b(NULL) { b = new char[chunksz]; }
-		~buffer () { delete [] (char*)b; }
+		char* b;
+		buffer (size_t chunksz) : b(NULL) { b = new char[2*chunksz]; }
+		~buffer () { delete [] b; }
 	} buf(chunksz);
-	::lseek(file_w, 0, SEEK_SET);
-	size_t bytes_rest = sz;
-	while (bytes_rest != 0) {
-		if (bytes_rest < chunksz) 
-			chunksz = bytes_rest;
-		errno_reset;
-		ssize_t rs;
-		size_t recsz;
-		recsz = (s.*i)(buf.b, chunksz);
+	pipelined_hasher hasher (hash, sz > 4*chunksz); // Destructed before the buffer
+	for (uint8_t k = 0; bytes_rest != 0; k ^= 1) {
+		char* b = buf.b + k*chunksz;
+		size_t recsz = (s.*i)(b, (bytes_rest < chunksz) ? bytes_rest : chunksz);
 		bytes_rest -= recsz;
-	#ifdef XIF_USE_SSL
-		r = MD5_Update(&hashctx, buf.b, recsz);
-		if (r != 1)
-			throw socketxx::error("file transfer : MD5_Update() failed");
-	#endif
 		if (info_f)
 			info_f (sz-bytes_rest, sz);
-		size_t file_rest = (size_t)recsz;
-		rs = ::write(file_w, buf.b, file_rest);
-	_err:
-		if (rs < 1) 
-			throw socketxx::other_error("read_to_file : failed to write to file");
-		if ((size_t)rs != file_rest) {
-			uint8_t* b = (uint8_t*)buf.b + rs;
-			file_rest -= (size_t)rs;
-			while (file_rest != 0) {
-				file_rest -= (size_t)rs;
-				b += rs;
-				rs = ::write(file_w, b, file_rest);
-				if (rs < 1) 
-					goto _err;
-			}
-		}
+		write_all(file_w, b, recsz);
+		hasher.submit(b, recsz); // Waits for the hash of the other buffer, which will be reused
 	}
-#ifdef XIF_USE_SSL
-	unsigned char* hash = new unsigned char[MD5_DIGEST_LENGTH];
-	r = MD5_Final(hash, &hashctx);
-	if (r != 1)
-		throw socketxx::error("file transfer : MD5_Final() failed ");
-	return hash;
-#else
-	return NULL;
-#endif
+	return hasher.final();
 }
 
-	/// Write from file to socket using mmap for zero-copy behavior
-socketxx::auto_bdata socketxx::io::_simple_socket::write_from_file (socketxx::base_fd& s, base_fd::_io_fncts::i_fnct i, base_fd::_io_fncts::o_fnct o, fd_t file_r, size_t sz, _simple_socket::trsf_info_f info_f) {
-	if (sz == 0) return NULL;
-	int r;
-#ifdef XIF_USE_SSL
-	MD5_CTX hashctx; MD5_Init(&hashctx);
-#endif
+	/// Write from file to socket using mmap for zero-copy behavior. Each chunk is hashed by the hash thread while it is sent.
+socketxx::auto_bdata socketxx::io::_simple_socket::write_from_file (socketxx::base_fd& s, base_fd::_io_fncts::i_fnct i, base_fd::_io_fncts::o_fnct o, fd_t file_r, size_t sz, _simple_socket::trsf_info_f info_f, hash_t hash) {
+	if (sz == 0) return auto_bdata();
 	size_t bytes_done = 0;
 	size_t chunksz = (size_t)::getpagesize() * 16;
 	size_t chunk_rest = sz / chunksz;
+	pipelined_hasher hasher (hash, sz > 4*chunksz);
 	for (off_t off_f = 0;; off_f += chunksz) {
 		if (chunk_rest == 0) {
 			if (sz%chunksz != 0) chunksz = sz%chunksz;
@@ -139,12 +381,15 @@ socketxx::auto_bdata socketxx::io::_simple_socket::write_from_file (socketxx::ba
 		void* mapchunk = ::mmap(NULL, chunksz, PROT_READ, MAP_SHARED|MAP_FILE, file_r, off_f);
 		if (mapchunk == MAP_FAILED) 
 			throw socketxx::other_error("file send : mmap() failed");
-		(s.*o)(mapchunk, chunksz);
-	#ifdef XIF_USE_SSL
-		r = MD5_Update(&hashctx, mapchunk, chunksz);
-		if (r != 1)
-			throw socketxx::error("file send : MD5_Update() failed");
-	#endif
+		hasher.submit(mapchunk, chunksz);
+		try {
+			(s.*o)(mapchunk, chunksz);
+		} catch (...) {
+			hasher.wait();
+			::munmap(mapchunk, chunksz);
+			throw;
+		}
+		hasher.wait();
 		::munmap(mapchunk, chunksz);
 		if (info_f) {
 			bytes_done += chunksz;
@@ -153,36 +398,14 @@ socketxx::auto_bdata socketxx::io::_simple_socket::write_from_file (socketxx::ba
 		if (chunk_rest == 0) break;
 		chunk_rest--;
 	}
-#ifdef XIF_USE_SSL
-	auto_bdata hash = new unsigned char[MD5_DIGEST_LENGTH];
-	hash.len = MD5_DIGEST_LENGTH;
-	r = MD5_Final((unsigned char*)hash.p, &hashctx);
-	if (r != 1)
-		throw socketxx::error("file transfer : MD5_Final() failed");
-	return hash;
-#else
-	return NULL;
-#endif
+	return hasher.final();
 }
 
-	// Check checksums hashs. Autodelete[] hashs if not NULL.
-bool socketxx::io::_simple_socket::same_hash (unsigned char* hash, auto_bdata s_hash) {
-#ifdef XIF_USE_SSL
-	if (hash == NULL) 
+	// Compare hashs. No checksum on one side (NULL) is accepted.
+bool socketxx::io::_simple_socket::same_hash (auto_bdata hash, auto_bdata s_hash) {
+	if (hash.p == NULL or s_hash.p == NULL) 
 		return true;
-	if (s_hash.p == NULL) {
-		if (hash != NULL) delete[] hash;
-		return true;
-	}
-	if (s_hash.len != MD5_DIGEST_LENGTH)
-		throw socketxx::error("file transfer : bad MD5 hash length");
-	for (uint8_t i = 0; i < MD5_DIGEST_LENGTH; i++) {
-		if (hash[i] != ((unsigned char*)s_hash.p)[i]) {
-			delete[] hash;
-			return false;
-		}
-	}
-#endif
-	delete[] hash;
-	return true;
+	if (hash.len != s_hash.len)
+		throw socketxx::error("file transfer : hash length mismatch (different hash algorithms on each side ?)");
+	return ::memcmp(hash.p, s_hash.p, hash.len) == 0;
 }
@@ -4,17 +4,27 @@
 	// BaseIO
 #include <socket++/base_io.hpp>
 
+	// Checksums
+#include <socket++/io/checksum.hpp>
+
 	// General
 #include <inttypes.h>
 #include <string>
 #include <utility>
 #include <xifutils/polyvar.hpp>
 #include <type_traits>
+#include <limits>
 #include <functional>
+#include <tuple>
+#include <vector>
+#include <string.h>
 
 	// OS headers
 #include <unistd.h>
 
+	// UNIX sockets pass fds with SCM_RIGHTS
+namespace socketxx { class base_unixsock; }
+
 namespace socketxx { namespace io {
 	
 		// Private external functions
@@ -22,15 +32,122 @@ namespace socketxx { namespace io {
 		
 			// Swap bytes when foreign host don't have the same endianness
 		void swapBytes (void* data_to_swap, size_t size);
+		void swapBytesArray (void* array, size_t elsize, size_t count);
+		
+			// Typed arrays : elements must be integers or IEEE754 floating point numbers of 1, 2, 4 or 8 bytes
+		template <typename num_t> struct array_elem {
+			static const bool value = std::is_arithmetic<num_t>::value and (sizeof(num_t) == 1 or sizeof(num_t) == 2 or sizeof(num_t) == 4 or sizeof(num_t) == 8);
+		};
+		const size_t array_swapbuf_sz = 64*1024; // Chunk size for swapping sent arrays when endianness is not the same
+		
+			// Compact integers : LEB128 varints, signed integers are zigzag-encoded
+		const size_t varint_maxsz = 10;
+		size_t varint_encode (uint64_t n, uint8_t* buf); // `buf` must hold `varint_maxsz` bytes. Returns the encoded size
+		inline size_t varint_size (uint64_t n) { size_t sz = 1; while (n >= 0x80) { n >>= 7; sz++; } return sz; }
+		template <typename int_t> inline typename std::enable_if<std::is_signed<int_t>::value,uint64_t>::type zigzag_enc (int_t n)   { return ((uint64_t)(int64_t)n << 1) ^ (uint64_t)((int64_t)n >> 63); }
+		template <typename int_t> inline typename std::enable_if<std::is_unsigned<int_t>::value,uint64_t>::type zigzag_enc (int_t n) { return (uint64_t)n; }
+		template <typename int_t> inline typename std::enable_if<std::is_signed<int_t>::value,int_t>::type zigzag_dec (uint64_t n)   { return (int_t)((int64_t)(n >> 1) ^ -(int64_t)(n & 1)); }
+		template <typename int_t> inline typename std::enable_if<std::is_unsigned<int_t>::value,int_t>::type zigzag_dec (uint64_t n) { return (int_t)n; }
+		extern const socketxx::error bad_varint;
+			// Decode a varint from `avail` bytes. Returns its size, 0 if incomplete. Throws bad_varint if longer than 64 bits
+		size_t varint_decode (const uint8_t* p, size_t avail, uint64_t& n);
+			// Decoded value as `int_t`. Throws bad_varint if it does not fit
+		template <typename int_t> inline int_t varint_to (uint64_t n) {
+			if (n > (uint64_t)std::numeric_limits<typename std::make_unsigned<int_t>::type>::max()) throw bad_varint;
+			return zigzag_dec<int_t>(n);
+		}
+			// Bytes already received on a socket, copied without being consumed. 0 if none
+		size_t peek_sock (fd_t fd, void* buf, size_t len);
+		
+			// Typed messages : encoding of each field type, identical to the corresponding o_* method.
+			// `fixsz` is the size of the field when it does not depend on the value in non-compact mode, 0 otherwise.
+		template <typename T, typename = void> struct msg_field {
+			static_assert(sizeof(T) == 0, "simple_socket typed messages : unsupported field type");
+		};
+		template <> struct msg_field<bool> {
+			static const size_t fixsz = 1;
+			static size_t size (bool, bool)                           { return 1; }
+			static uint8_t* put (uint8_t* p, bool b, bool)            { *p = (uint8_t)b; return p+1; }
+			static bool get (const uint8_t* p)                        { return (bool)*p; }
+			template <typename S> static bool read (S& s)             { return s.i_bool(); }
+		};
+		template <> struct msg_field<char> {
+			static const size_t fixsz = 1;
+			static size_t size (char, bool)                           { return 1; }
+			static uint8_t* put (uint8_t* p, char c, bool)            { *p = (uint8_t)c; return p+1; }
+			static char get (const uint8_t* p)                        { return (char)*p; }
+			template <typename S> static char read (S& s)             { return s.i_char(); }
+		};
+		template <typename int_t> struct msg_field<int_t, typename std::enable_if<std::is_integral<int_t>::value and not std::is_same<int_t,bool>::value and not std::is_same<int_t,char>::value>::type> {
+			static const size_t fixsz = sizeof(int_t);
+			static size_t size (int_t n, bool compact)                { return compact ? varint_maxsz : sizeof(int_t); }
+			static uint8_t* put (uint8_t* p, int_t n, bool compact)   { if (compact) return p + varint_encode(zigzag_enc<int_t>(n), p);
+			                                                            if (not XIF_SOCKETXX_ENDIANNESS_SAME) { swapBytes(&n, sizeof(int_t)); } ::memcpy(p, &n, sizeof(int_t)); return p+sizeof(int_t); }
+			static int_t get (const uint8_t* p)                       { int_t n; ::memcpy(&n, p, sizeof(int_t)); if (not XIF_SOCKETXX_ENDIANNESS_SAME) { swapBytes(&n, sizeof(int_t)); } return n; }
+			template <typename S> static int_t read (S& s)            { return s.template i_int<int_t>(); }
+		};
+		template <> struct msg_field<double> {
+			static const size_t fixsz = 8;
+			static size_t size (double, bool)                         { return 8; }
+			static uint8_t* put (uint8_t* p, double f, bool)          { return msg_field<int64_t>::put(p, *((int64_t*)&f), false); }
+			static double get (const uint8_t* p)                      { int64_t t = msg_field<int64_t>::get(p); return *((double*)&t); }
+			template <typename S> static double read (S& s)           { return s.i_float(); }
+		};
+		template <> struct msg_field<std::string> {
+			static const size_t fixsz = 0;
+			static uint8_t* put_str (uint8_t* p, const char* str, uint64_t len, bool compact) {
+				if (compact) p += varint_encode(len, p);
+				else if (len > 254) { *p++ = 255; p = msg_field<uint64_t>::put(p, len, false); }
+				else *p++ = (uint8_t)len;
+				::memcpy(p, str, len); return p+len;
+			}
+			static size_t size (const std::string& str, bool)         { return varint_maxsz + str.length(); }
+			static uint8_t* put (uint8_t* p, const std::string& str, bool compact) { return put_str(p, str.c_str(), str.length(), compact); }
+			template <typename S> static std::string read (S& s)      { return s.i_str(); }
+		};
+		template <> struct msg_field<const char*> {
+			static const size_t fixsz = 0;
+			static size_t size (const char* str, bool)                { return varint_maxsz + ::strlen(str); }
+			static uint8_t* put (uint8_t* p, const char* str, bool compact) { return msg_field<std::string>::put_str(p, str, ::strlen(str), compact); }
+		};
+		template <> struct msg_field<char*> : msg_field<const char*> {};
+		
+			// Typed messages : recursive size, serialization and fixed-size prefix
+		inline size_t msg_size (bool) { return 0; }
+		template <typename T, typename... Ts> inline size_t msg_size (bool compact, const T& v, const Ts&... rest) 
+			{ return msg_field<typename std::decay<T>::type>::size(v, compact) + msg_size(compact, rest...); }
+		inline uint8_t* msg_put (uint8_t* p, bool) { return p; }
+		template <typename T, typename... Ts> inline uint8_t* msg_put (uint8_t* p, bool compact, const T& v, const Ts&... rest) 
+			{ return msg_put(msg_field<typename std::decay<T>::type>::put(p, v, compact), compact, rest...); }
+		template <typename... Ts> struct msg_fixprefix { static const size_t value = 0; };
+		template <typename T, typename... Ts> struct msg_fixprefix<T, Ts...> 
+			{ static const size_t value = (msg_field<T>::fixsz == 0) ? 0 : msg_field<T>::fixsz + msg_fixprefix<Ts...>::value; };
+		struct msg_reader { const uint8_t* p; size_t rest; };
+		
+			// Serialization buffer : on the stack for small messages, on the heap otherwise
+		const size_t msg_stackbuf_sz = 512;
+		struct serial_buffer {
+			uint8_t stack[msg_stackbuf_sz];
+			uint8_t* const b;
+			serial_buffer (size_t sz) : b( (sz <= msg_stackbuf_sz) ? stack : new uint8_t[sz] ) {}
+			~serial_buffer () { if (b != stack) delete[] b; }
+		};
+		
+			// Polyvar codec : the whole tree is serialized in one buffer (exact size precomputed) for a single write.
+			// Reading never requests more bytes than the remaining of the polyvar is guaranteed to contain, 
+			//  so big lists or maps are received in a few bulk reads without reading past the end of the message.
+		size_t var_size (const xif::polyvar& var, bool compact);
+		uint8_t* var_put (uint8_t* p, const xif::polyvar& var, bool compact);
+		xif::polyvar read_var (socketxx::base_fd& s, base_fd::_io_fncts::i_fnct i, bool compact);
 		
 			// Duplicate file descriptor for sending
 		fd_t dup_fd (fd_t orig_fd);
 		
 			// File transfer functions
 		typedef std::function< void (size_t done, size_t tot) > trsf_info_f;
-		unsigned char* read_to_file (socketxx::base_fd& s, base_fd::_io_fncts::i_fnct i, base_fd::_io_fncts::o_fnct o, fd_t file_w, size_t sz, trsf_info_f); // Read from socket and write to file (return hash if enabled or NULL)
-		auto_bdata write_from_file (socketxx::base_fd& s, base_fd::_io_fncts::i_fnct i, base_fd::_io_fncts::o_fnct o, fd_t file_r, size_t sz, trsf_info_f); // Read from file and write to socket
-		bool same_hash (unsigned char* hash, auto_bdata s_hash); // Autodelete[] hashs
+		auto_bdata read_to_file (socketxx::base_fd& s, base_fd::_io_fncts::i_fnct i, base_fd::_io_fncts::o_fnct o, bool raw, fd_t file_w, size_t sz, trsf_info_f, hash_t); // Read from socket and write to file (return hash or NULL). Zero-copy if `raw` and no hash.
+		auto_bdata write_from_file (socketxx::base_fd& s, base_fd::_io_fncts::i_fnct i, base_fd::_io_fncts::o_fnct o, fd_t file_r, size_t sz, trsf_info_f, hash_t); // Read from file and write to socket (return hash or NULL)
+		bool same_hash (auto_bdata hash, auto_bdata s_hash);
 		fd_t create_temp_file (std::string& file_name); // file_name is only a prefix, not a template name
 		size_t open_file_read (fd_t& filefd, const char* path); // Open a file and returns size
 	}
@@ -47,11 +164,21 @@ namespace socketxx { namespace io {
 	 *   - integers of all sizes, without caring of endianness
 	 *   - floats - warning, internal representation is assumed to be IEEE754 for non local networks and sizeof(double)=8
 	 *   - a simple byte (char)
-	 *   - a file, with MD5 checksum if socket++ is openssl-enabled on both side
-	 *   - binary data with automatic alloc and dynamic size (max 4GiB) for receiver, with support of sending NULL
+	 *   - a file, with a checksum chosen per transfer (same on both side), computed on a separate thread :
+	 *      MD5 by default if socket++ is openssl-enabled, CRC32C or xxHash64 for speed.
+	 *      Without checksum (HASH_NONE), TLS and I/O deadline, the file is received with splice(), without copy to userspace
+	 *   - binary data with automatic alloc and dynamic size (max 4GiB) for receiver, with support of sending NULL.
+	 *      Received auto_bdata can be allocated from a buffer pool : see set_bin_allocator()
 	 *   - binary buffers in a dumb manner, with sizes defined at both side, which shall coincide
 	 *   - a socket itself, only on the *same* process, eg. between threads. The fd is dup(), so original sock can be destructed
 	 *   - a xifutils polyvar, recursively if needed
+	 *  Integers, string/binary sizes and polyvar list/map counts can be sent in a compact form, as LEB128 varints 
+	 *   (zigzag-encoded if signed). This mode is opt-in and must be the same on both side : see set_compact() 
+	 *   and negotiate_compact(). Floats are not affected.
+	 *  Arrays of integers or floats are sent as a count followed by the raw elements (never compacted) in one write, 
+	 *   and received in place : see o_array/i_array.
+	 *  Typed messages (o_msg/i_msg) serialize a whole record of basic fields in one buffer and send it at once,
+	 *   with the same wire format as the equivalent chain of o_* calls.
 	 *  The only thing you need to care about is the type of data and order : 
 	 *   don't send a 64bits integer and try to receive a unsigned 16bits one.
 	 *  Il will ofter results to an io_error, and it's very difficult to find the 
@@ -63,15 +190,56 @@ namespace socketxx { namespace io {
 	protected:
 		
 			// Private relay constructors
-		simple_socket (bool autoclose_handle, socket_t handle) : io_base(autoclose_handle, handle) {}
-		simple_socket () : io_base() {}
+		simple_socket (bool autoclose_handle, socket_t handle) : io_base(autoclose_handle, handle), compact(false), bin_alloc(NULL) {}
+		simple_socket () : io_base(), compact(false), bin_alloc(NULL) {}
+		
+			// Compact integers mode
+		bool compact;
+		template <typename int_t> void _o_fixint (int_t num) { if (not XIF_SOCKETXX_ENDIANNESS_SAME) { _simple_socket::swapBytes(&num, sizeof(int_t)); } io_base::_o(&num, sizeof(int_t)); }
+		template <typename int_t> int_t _i_fixint ()        { int_t n; io_base::_i_fixsize(&n, sizeof(int_t)); if (not XIF_SOCKETXX_ENDIANNESS_SAME) { _simple_socket::swapBytes(&n, sizeof(int_t)); } return n; }
+		template <typename int_t> void _o_varint (int_t num) { uint8_t b[_simple_socket::varint_maxsz]; io_base::_o(b, _simple_socket::varint_encode(_simple_socket::zigzag_enc<int_t>(num), b)); }
+		template <typename int_t> int_t _i_varint ();
+		
+			// Allocator for auto_bdata binary data. NULL for new[]
+		bdata_allocator* bin_alloc;
+		
+			// Typed messages field reading : from the fixed-size prefix if available, from the socket otherwise
+		template <typename T> T _i_msg_field (_simple_socket::msg_reader& rd) { return this->_i_msg_field<T>(rd, std::integral_constant<bool, _simple_socket::msg_field<T>::fixsz != 0>()); }
+		template <typename T> T _i_msg_field (_simple_socket::msg_reader&, std::false_type) { return _simple_socket::msg_field<T>::read(*this); }
+		template <typename T> T _i_msg_field (_simple_socket::msg_reader& rd, std::true_type) {
+			typedef _simple_socket::msg_field<T> field;
+			if (rd.rest < field::fixsz) 
+				return field::read(*this);
+			rd.rest -= field::fixsz;
+			rd.p += field::fixsz;
+			return field::get(rd.p - field::fixsz);
+		}
+			
+			// Sockets passing
+		socketxx::base_fd _i_sock (std::true_type)          { return io_base::i_sock(); }
+		socketxx::base_fd _i_sock (std::false_type)         { fd_t fd = this->i_int<fd_t>(); return socketxx::base_fd(fd, true); }
+		void _o_sock (socketxx::base_fd& sock, std::true_type)  { io_base::o_sock(sock); }
+		void _o_sock (socketxx::base_fd& sock, std::false_type) { sock.set_preserved(); fd_t new_fd = _simple_socket::dup_fd(sock.get_fd()); this->o_int<fd_t>(new_fd); }
 			
 	public:
 		
 			// Copy constructor
-		simple_socket (const simple_socket<io_base>& other) : io_base(other) {}
+		simple_socket (const simple_socket<io_base>& other) : io_base(other), compact(other.compact), bin_alloc(other.bin_alloc) {}
+			// Move constructor and assignments
+		simple_socket (simple_socket<io_base>&& other) noexcept : io_base(std::move(other)), compact(other.compact), bin_alloc(other.bin_alloc) {}
+		simple_socket& operator= (const simple_socket<io_base>&) = default;
+		simple_socket& operator= (simple_socket<io_base>&&) = default;
 			// Construct from an io_base object
-		simple_socket (const io_base& iob) : io_base(iob) {}
+		simple_socket (const io_base& iob) : io_base(iob), compact(false), bin_alloc(NULL) {}
+		
+			// Compact integers mode. Modifications do not spread across copies.
+		void set_compact (bool enable)                      { compact = enable; }
+		bool is_compact () const                            { return compact; }
+			// Both sides tell if they want compact mode : it is enabled only if both want it. Returns the chosen mode.
+		bool negotiate_compact (bool want = true)           { this->o_bool(want); bool peer = this->i_bool(); compact = (want and peer); return compact; }
+		
+			// Allocator used by i_bin() for auto_bdata, eg. a socketxx::bdata_pool. NULL (default) for new[]. Modifications do not spread across copies.
+		void set_bin_allocator (bdata_allocator* alloc)     { bin_alloc = alloc; }
 		
 	public:
 		
@@ -79,27 +247,33 @@ namespace socketxx { namespace io {
 		char i_char ()                                      { char c; io_base::_i_fixsize(&c, 1); return c; }
 		bool i_bool ()                                      { bool b; io_base::_i_fixsize(&b, 1); return b; }
 		std::string i_str ();
-		template <typename int_t> int_t i_int ()            { int_t n; io_base::_i_fixsize(&n, sizeof(int_t)); return n; } // Endianness is already converted by sender
-		double i_float ()                                   { int64_t t = this->i_int<int64_t>(); return *((double*)&t); } // Size of doubles must be 8 bytes and internal representation must be the same on both side
-		size_t i_file (fd_t file_w, _simple_socket::trsf_info_f = NULL);                       // Return the file's size.
-		std::string i_file (std::string file_prefix, _simple_socket::trsf_info_f = NULL);      // Create temporary file in tmp dir with template name. Return the file path. File is RW.
+		template <typename int_t> int_t i_int ()            { if (compact) return this->_i_varint<int_t>(); else return this->_i_fixint<int_t>(); }
+		double i_float ()                                   { int64_t t = this->_i_fixint<int64_t>(); return *((double*)&t); } // Size of doubles must be 8 bytes and internal representation must be the same on both side
+		size_t i_file (fd_t file_w, _simple_socket::trsf_info_f = NULL, hash_t = HASH_DEFAULT);                       // Return the file's size.
+		std::string i_file (std::string file_prefix, _simple_socket::trsf_info_f = NULL, hash_t = HASH_DEFAULT);      // Create temporary file in tmp dir with template name. Return the file path. File is RW.
 		void i_buf (void* buf, size_t len)                  { io_base::_i_fixsize(buf, len); } // Size is guaranteed to be the final read size
 		void* i_bin (size_t& len)                           { len = i_int<uint32_t>(); if (!len) return NULL; void* p = new char[len]; io_base::_i_fixsize(p,len); return p; } // Need to be deleted[] if not NULL
-		auto_bdata i_bin ()                                 { auto_bdata bd; bd.p = this->i_bin(bd.len); return bd; }      // Autodelete data with refcounting 
-		socketxx::base_fd i_sock ()                         { fd_t fd = this->i_int<fd_t>(); return socketxx::base_fd(fd, true); }
+		auto_bdata i_bin ();                                // Autodelete data with refcounting, allocated with the bin allocator
+		socketxx::base_fd i_sock ()                         { return this->_i_sock(std::is_base_of<socketxx::base_unixsock,io_base>()); } // See o_sock()
 		xif::polyvar i_var ();
+		template <typename... Ts> std::tuple<Ts...> i_msg (); // Typed message, sent with o_msg or the equivalent o_* calls. The fixed-size prefix is read at once.
+		template <typename num_t> size_t i_array (num_t* arr, size_t max_n); // Read an array sent with o_array directly in `arr`. Returns the number of elements. Throws if more than `max_n`.
+		template <typename num_t> std::vector<num_t> i_array ();
 			// Public write methods
 		void o_char (char byte)                             { io_base::_o(&byte, 1); }
 		void o_bool (bool b)                                { io_base::_o(&b, 1); }
 		void o_str (const std::string& str);
-		template <typename int_t> void o_int (int_t num)    { if (not XIF_SOCKETXX_ENDIANNESS_SAME) { _simple_socket::swapBytes(&num, sizeof(int_t)); } io_base::_o(&num, sizeof(int_t)); }
-		void o_float (double f)                             { this->o_int<int64_t>(*((int64_t*)&f)); }
-		void o_file (fd_t file_r, size_t file_size, _simple_socket::trsf_info_f = NULL);
-		void o_file (const char* path, _simple_socket::trsf_info_f = NULL);
+		template <typename int_t> void o_int (int_t num)    { if (compact) this->_o_varint<int_t>(num); else this->_o_fixint<int_t>(num); }
+		void o_float (double f)                             { this->_o_fixint<int64_t>(*((int64_t*)&f)); }
+		void o_file (fd_t file_r, size_t file_size, _simple_socket::trsf_info_f = NULL, hash_t = HASH_DEFAULT);
+		void o_file (const char* path, _simple_socket::trsf_info_f = NULL, hash_t = HASH_DEFAULT);
 		void o_buf (const void* buf, size_t len)            { io_base::_o(buf, len); }
 		void o_bin (const void* p, size_t len)              { if (p == NULL) len = 0; this->o_int<uint32_t>((uint32_t)len); if (len != 0) io_base::_o(p, len); } // if len is 0, assuming NULL
-		void o_sock (socketxx::base_fd& sock)               { sock.set_preserved(); fd_t new_fd = _simple_socket::dup_fd(sock.get_fd()); this->o_int<fd_t>(new_fd); } // dup the file descriptor, sock can be closed afetr
+		void o_sock (socketxx::base_fd& sock)               { this->_o_sock(sock, std::is_base_of<socketxx::base_unixsock,io_base>()); } // UNIX sockets : passed with SCM_RIGHTS, to any process. Else : dup the file descriptor, within the same process. sock can be closed after
 		void o_var (const xif::polyvar& var);
+		template <typename... Ts> void o_msg (const Ts&... fields); // Serialize all fields (bool, char, integers, double, strings) and send them at once
+		template <typename num_t> void o_array (const num_t* arr, size_t n); // Send `n` integers or floats in one bulk payload
+		template <typename num_t> void o_array (const std::vector<num_t>& arr) { this->o_array<num_t>(arr.data(), arr.size()); }
 		
 #ifndef XIF_SOCKETXX_NO_STREAM_OPERATORS
 			// Public stream-like read
@@ -120,15 +294,110 @@ namespace socketxx { namespace io {
 	
 	/*** Implementation ***/
 	
+		// Compact integers : read LEB128 varint. Small values cost only one read. On raw sockets, the following bytes
+		//  are usually already received : they are peeked and consumed in one read. Otherwise, read byte by byte
+		//  (from the buffer of buffered BaseIOs).
+	template <typename io_base> template <typename int_t>
+	int_t simple_socket<io_base>::_i_varint () {
+		uint8_t b[_simple_socket::varint_maxsz];
+		io_base::_i_fixsize(b, 1);
+		if (b[0] < 0x80) 
+			return _simple_socket::varint_to<int_t>(b[0]);
+		uint64_t n;
+		if (std::is_base_of<socketxx::base_socket, io_base>::value and this->_get_io_fncts().raw) {
+			size_t k = _simple_socket::peek_sock(this->fd, b+1, _simple_socket::varint_maxsz-1);
+			size_t sz = _simple_socket::varint_decode(b, 1+k, n);
+			if (sz != 0) {
+				io_base::_i_fixsize(b+1, sz-1);
+				return _simple_socket::varint_to<int_t>(n);
+			}
+		}
+		size_t k = 1;
+		do {
+			if (k == _simple_socket::varint_maxsz) 
+				throw _simple_socket::bad_varint;
+			io_base::_i_fixsize(b+k, 1);
+		} while (b[k++] >= 0x80);
+		_simple_socket::varint_decode(b, k, n);
+		return _simple_socket::varint_to<int_t>(n);
+	}
+	
+		// Typed messages
+	template <typename io_base> template <typename... Ts>
+	void simple_socket<io_base>::o_msg (const Ts&... fields) {
+		_simple_socket::serial_buffer buf (_simple_socket::msg_size(compact, fields...));
+		uint8_t* end = _simple_socket::msg_put(buf.b, compact, fields...);
+		io_base::_o(buf.b, (size_t)(end-buf.b));
+	}
+	template <typename io_base> template <typename... Ts>
+	std::tuple<Ts...> simple_socket<io_base>::i_msg () {
+		const size_t prefix = _simple_socket::msg_fixprefix<Ts...>::value;
+		uint8_t b[prefix ? prefix : 1];
+		_simple_socket::msg_reader rd = { b, compact ? 0 : prefix }; // In compact mode, integers have no fixed size
+		if (rd.rest != 0) 
+			io_base::_i_fixsize(b, rd.rest);
+		return std::tuple<Ts...>{ this->_i_msg_field<Ts>(rd)... }; // Braced init list : fields are read in order
+	}
+	
+		// Typed arrays : element count, then the elements in little-endian order
+	template <typename io_base> template <typename num_t>
+	void simple_socket<io_base>::o_array (const num_t* arr, size_t n) {
+		static_assert(_simple_socket::array_elem<num_t>::value, "simple_socket arrays : unsupported element type");
+		this->o_int<uint64_t>(n);
+		if (n == 0) return;
+		if (XIF_SOCKETXX_ENDIANNESS_SAME or sizeof(num_t) == 1) {
+			io_base::_o(arr, n*sizeof(num_t));
+			return;
+		}
+		const size_t chunk_n = _simple_socket::array_swapbuf_sz / sizeof(num_t);
+		struct buffer {
+			num_t* b;
+			buffer (size_t sz) : b(NULL) { b = new num_t[sz]; }
+			~buffer () { delete[] b; }
+		} buf( (n < chunk_n) ? n : chunk_n );
+		for (size_t done = 0; done < n;) {
+			size_t k = (n-done < chunk_n) ? n-done : chunk_n;
+			::memcpy(buf.b, arr+done, k*sizeof(num_t));
+			_simple_socket::swapBytesArray(buf.b, sizeof(num_t), k);
+			io_base::_o(buf.b, k*sizeof(num_t));
+			done += k;
+		}
+	}
+	template <typename io_base> template <typename num_t>
+	size_t simple_socket<io_base>::i_array (num_t* arr, size_t max_n) {
+		static_assert(_simple_socket::array_elem<num_t>::value, "simple_socket arrays : unsupported element type");
+		uint64_t n = this->i_int<uint64_t>();
+		if (n > max_n) 
+			throw socketxx::error("simple_socket : received array is bigger than buffer");
+		if (n == 0) return 0;
+		io_base::_i_fixsize(arr, (size_t)n*sizeof(num_t));
+		if (not XIF_SOCKETXX_ENDIANNESS_SAME) 
+			_simple_socket::swapBytesArray(arr, sizeof(num_t), (size_t)n);
+		return (size_t)n;
+	}
+	template <typename io_base> template <typename num_t>
+	std::vector<num_t> simple_socket<io_base>::i_array () {
+		static_assert(_simple_socket::array_elem<num_t>::value, "simple_socket arrays : unsupported element type");
+		uint64_t n = this->i_int<uint64_t>();
+		std::vector<num_t> arr ((size_t)n);
+		if (n == 0) return arr;
+		io_base::_i_fixsize(arr.data(), (size_t)n*sizeof(num_t));
+		if (not XIF_SOCKETXX_ENDIANNESS_SAME) 
+			_simple_socket::swapBytesArray(arr.data(), sizeof(num_t), (size_t)n);
+		return arr;
+	}
+	
 		// String transfer functions
 	template <typename io_base> 
 	void simple_socket<io_base>::o_str (const std::string& str) {
 		uint64_t str_len64 = (uint64_t)str.length();
 		uint8_t str_len8 = (uint8_t)str_len64;
-		if (str_len64 > 254) {
+		if (compact) {
+			this->_o_varint<uint64_t>(str_len64);
+		} else if (str_len64 > 254) {
 			str_len8 = 255;
 			this->io_base::_o(&str_len8, 1);
-			this->simple_socket::o_int<uint64_t>(str_len64);
+			this->_o_fixint<uint64_t>(str_len64);
 		} else 
 			this->io_base::_o(&str_len8, 1);
 		if (str_len64 != 0)
@@ -138,99 +407,62 @@ namespace socketxx { namespace io {
 	std::string simple_socket<io_base>::i_str () {
 		uint64_t str_len64;
 		uint8_t str_len8;
-		this->io_base::_i_fixsize(&str_len8, 1);
-		if (str_len8 == 255) {
-			str_len64 = this->simple_socket::i_int<uint64_t>();
-		} else str_len64 = str_len8;
+		if (compact) {
+			str_len64 = this->_i_varint<uint64_t>();
+		} else {
+			this->io_base::_i_fixsize(&str_len8, 1);
+			if (str_len8 == 255) {
+				str_len64 = this->_i_fixint<uint64_t>();
+			} else str_len64 = str_len8;
+		}
 		if (str_len64 == 0)
 			return std::string();
-		else {
-			char* str = new char[str_len64];
-			try {
-				this->io_base::_i_fixsize(str, str_len64);
-			} catch (socketxx::error&) {
-				delete[] str;
-				throw;
-			}
-			std::string finalstr(str, str_len64);
-			delete[] str;
-			return finalstr;
-		}
+		std::string str ((size_t)str_len64, '\0'); // Read directly in the string storage
+		this->io_base::_i_fixsize(&str[0], (size_t)str_len64);
+		return str;
+	}
+	
+		// Binary data transfer functions
+	template <typename io_base> 
+	auto_bdata simple_socket<io_base>::i_bin () {
+		size_t len = this->i_int<uint32_t>();
+		if (len == 0) 
+			return auto_bdata();
+		auto_bdata bd ( (bin_alloc != NULL) ? bin_alloc->alloc(len) : new char[len], len, bin_alloc );
+		io_base::_i_fixsize(bd.p, len);
+		return bd;
 	}
 	
-		// Polyvar recursive functions
+		// Polyvar transfer functions
 	template <typename io_base> 
 	void simple_socket<io_base>::o_var (const xif::polyvar& p) {
-		using namespace xif;
-		this->o_char((char)p.type());
-		switch (p.type()) {
-			case polyvar::VOID:                               break;
-			case polyvar::STR:   this->o_str(p.s());          break;
-			case polyvar::FLOAT: this->o_float(p.f());        break;
-			case polyvar::INT:   this->o_int<int64_t>(p.i()); break;
-			case polyvar::CHAR:  this->o_char(p.c());         break;
-			case polyvar::BOOL:  this->o_bool(p.b());         break;
-			case polyvar::LIST: {
-				const std::vector<xif::polyvar>& v = p.v();
-				this->o_int<uint64_t>(v.size());
-				for (size_t i = 0; i < v.size(); i++) 
-					this->o_var(v[i]);
-			} break;
-			case polyvar::MAP: {
-				const std::map<std::string,xif::polyvar>& m = p.m();
-				this->o_int<uint64_t>(m.size());
-				for (auto it = m.begin(); it != m.end(); it++) {
-					this->o_str(it->first);
-					this->o_var(it->second);
-				}
-			} break;
-		}
+		_simple_socket::serial_buffer buf (_simple_socket::var_size(p, compact));
+		uint8_t* end = _simple_socket::var_put(buf.b, p, compact);
+		io_base::_o(buf.b, (size_t)(end-buf.b));
 	}
 	template <typename io_base> 
 	xif::polyvar simple_socket<io_base>::i_var () {
-		using namespace xif;
-		enum xif::polyvar::type t = (enum xif::polyvar::type)(this->i_char());
-		switch (t) {
-			case polyvar::VOID:  return xif::polyvar( );
-			case polyvar::STR:   return xif::polyvar( this->i_str() );
-			case polyvar::FLOAT: return xif::polyvar( this->i_float() );
-			case polyvar::INT:   return xif::polyvar( this->i_int<int64_t>() );
-			case polyvar::CHAR:  return xif::polyvar( this->i_char() );
-			case polyvar::BOOL:  return xif::polyvar( this->i_bool() );
-			case polyvar::LIST: {
-				xif::polyvar p = std::vector<xif::polyvar>( this->i_int<uint64_t>() );
-				for (size_t i = 0; i < p.v().size(); i++) 
-					p.v()[i] = this->i_var();
-				return p;
-			}
-			case polyvar::MAP: {
-				xif::polyvar p = std::map<std::string,xif::polyvar>();
-				size_t sz = this->i_int<uint64_t>();
-				for (; sz != 0; sz--) 
-					p.m().insert( std::pair<std::string,xif::polyvar>( this->i_str(), this->i_var() ));
-				return p;
-			}
-		}
+		return _simple_socket::read_var(*this, this->_get_io_fncts().i, compact);
 	}
 	
 		// File transfer functions
 	template <typename io_base> 
-	size_t simple_socket<io_base>::i_file (fd_t file_w, _simple_socket::trsf_info_f info_f) {
+	size_t simple_socket<io_base>::i_file (fd_t file_w, _simple_socket::trsf_info_f info_f, hash_t hash) {
 		size_t sz = this->i_int<uint64_t>();
-		unsigned char* hash = _simple_socket::read_to_file(*this, this->_get_io_fncts().i, this->_get_io_fncts().o, file_w, sz, info_f);
-		if (not _simple_socket::same_hash(hash, this->i_bin())) 
-			throw socketxx::error("File transfer : MD5 checksums don't mach !");
+		auto_bdata r_hash = _simple_socket::read_to_file(*this, this->_get_io_fncts().i, this->_get_io_fncts().o, this->_get_io_fncts().raw, file_w, sz, info_f, hash);
+		if (not _simple_socket::same_hash(r_hash, this->i_bin())) 
+			throw socketxx::error("File transfer : checksums don't mach !");
 		return sz;
 	}
 	template <typename io_base> 
-	std::string simple_socket<io_base>::i_file (std::string file_name, _simple_socket::trsf_info_f info_f) {
+	std::string simple_socket<io_base>::i_file (std::string file_name, _simple_socket::trsf_info_f info_f, hash_t hash) {
 		fd_t tempfd = SOCKETXX_INVALID_HANDLE;
 		try {
 			size_t sz = this->i_int<uint64_t>();
 			tempfd = _simple_socket::create_temp_file(file_name);
-			unsigned char* hash = _simple_socket::read_to_file(*this, this->_get_io_fncts().i, this->_get_io_fncts().o, tempfd, sz, info_f);
-			if (not _simple_socket::same_hash(hash, this->i_bin())) 
-				throw socketxx::error("File transfer : MD5 checksums don't mach !");
+			auto_bdata r_hash = _simple_socket::read_to_file(*this, this->_get_io_fncts().i, this->_get_io_fncts().o, this->_get_io_fncts().raw, tempfd, sz, info_f, hash);
+			if (not _simple_socket::same_hash(r_hash, this->i_bin())) 
+				throw socketxx::error("File transfer : checksums don't mach !");
 		} catch (...) {
 			if (tempfd != SOCKETXX_INVALID_HANDLE) { ::close(tempfd); ::unlink(file_name.c_str()); }
 			throw;
@@ -239,17 +471,17 @@ namespace socketxx { namespace io {
 		return file_name;
 	}
 	template <typename io_base> 
-	void simple_socket<io_base>::o_file (fd_t file_r, size_t sz, _simple_socket::trsf_info_f info_f) {
+	void simple_socket<io_base>::o_file (fd_t file_r, size_t sz, _simple_socket::trsf_info_f info_f, hash_t hash) {
 		this->o_int<uint64_t>(sz);
-		auto_bdata hash = _simple_socket::write_from_file(*this, this->_get_io_fncts().i, this->_get_io_fncts().o, file_r, sz, info_f);
-		this->o_bin(hash.p, hash.len);
+		auto_bdata s_hash = _simple_socket::write_from_file(*this, this->_get_io_fncts().i, this->_get_io_fncts().o, file_r, sz, info_f, hash);
+		this->o_bin(s_hash.p, s_hash.len);
 	}
 	template <typename io_base> 
-	void simple_socket<io_base>::o_file (const char* path, _simple_socket::trsf_info_f info_f) {
+	void simple_socket<io_base>::o_file (const char* path, _simple_socket::trsf_info_f info_f, hash_t hash) {
 		fd_t filefd = SOCKETXX_INVALID_HANDLE;
 		size_t sz = _simple_socket::open_file_read(filefd, path);
 		try {
-			this->o_file(filefd, sz);
+			this->o_file(filefd, sz, info_f, hash);
 		} catch (...) {
 			::close(filefd); throw;
 		}
@@ -0,0 +1,298 @@
+#include <socket++/io/striped_file.hpp>
+
+	// OS headers
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+	// General headers
+#include <string.h>
+#include <exception>
+#include <algorithm>
+
+	// Threads
+#ifndef XIF_NO_THREADS
+	#include <pthread.h>
+#endif
+
+namespace socketxx { namespace io { namespace _striped_file {
+
+	/************* Striped file transfer Implementation *************/
+
+	const size_t piece_sz = 256*1024; // Chunks are read/written by pieces of this size
+	const char journal_magic[8] = { 's','x','j','r','n','l','0','1' };
+	const size_t journal_header_sz = sizeof(journal_magic) + 8 + 8 + 1;
+
+		/// Little-endian integers, as simple_socket
+	inline void put_u64 (uint8_t* p, uint64_t n) { for (uint8_t i = 0; i < 8; i++) p[i] = (uint8_t)(n >> (8*i)); }
+	inline uint64_t get_u64 (const uint8_t* p) { uint64_t n = 0; for (uint8_t i = 0; i < 8; i++) n |= (uint64_t)p[i] << (8*i); return n; }
+
+		/// Strict read and write with I/O functions
+	void c_read (conn& c, void* d, size_t len) {
+		uint8_t* p = (uint8_t*)d;
+		while (len != 0) {
+			size_t r = (c.s->*c.f.i)(p, len);
+			p += r;
+			len -= r;
+		}
+	}
+	void c_write (conn& c, const void* d, size_t len) { (c.s->*c.f.o)(d, len); }
+
+		/// Transfer state shared by the connection threads
+	struct transfer {
+		std::vector<conn>& conns;
+		fd_t fd;
+		size_t sz, chunk_sz;
+		hash_t hash;
+		std::vector<uint64_t> pending; // Chunks to transfer, dealt round-robin to the connections
+		_simple_socket::trsf_info_f info_f;
+		size_t bytes_done;
+			// Receiver only
+		fd_t journal;
+		std::vector<uint8_t> bitmap;
+		bool bad_chunks;
+#ifndef XIF_NO_THREADS
+		pthread_mutex_t mutex;
+#endif
+		transfer (std::vector<conn>& conns) : conns(conns), fd(SOCKETXX_INVALID_HANDLE), sz(0), chunk_sz(0), hash(HASH_NONE), bytes_done(0), journal(SOCKETXX_INVALID_HANDLE), bad_chunks(false) {
+#ifndef XIF_NO_THREADS
+			::pthread_mutex_init(&mutex, NULL);
+#endif
+		}
+		~transfer () {
+#ifndef XIF_NO_THREADS
+			::pthread_mutex_destroy(&mutex);
+#endif
+		}
+		void lock () {
+#ifndef XIF_NO_THREADS
+			::pthread_mutex_lock(&mutex);
+#endif
+		}
+		void unlock () {
+#ifndef XIF_NO_THREADS
+			::pthread_mutex_unlock(&mutex);
+#endif
+		}
+		size_t chunk_len (uint64_t idx) const { return (idx == (sz-1)/chunk_sz) ? sz - idx*chunk_sz : chunk_sz; }
+		void progress (size_t len) {
+			if (not info_f) return;
+			this->lock();
+			bytes_done += len;
+			try { info_f(bytes_done, sz); } catch (...) { this->unlock(); throw; }
+			this->unlock();
+		}
+		void make_pending () {
+			uint64_t n_chunks = (sz + chunk_sz - 1) / chunk_sz;
+			for (uint64_t i = 0; i < n_chunks; i++) {
+				if (not (bitmap[i/8] & (1 << (i%8))))
+					pending.push_back(i);
+				else
+					bytes_done += chunk_len(i); // Resumed transfer
+			}
+		}
+	};
+
+		/// Sending thread : read the chunks of the connection from the file, and send them with their digest
+	void send_chunks (transfer& t, size_t ci) {
+		conn& c = t.conns[ci];
+		std::vector<uint8_t> buf (piece_sz);
+		for (size_t k = ci; k < t.pending.size(); k += t.conns.size()) {
+			uint64_t idx = t.pending[k];
+			uint8_t hdr[8];
+			put_u64(hdr, idx);
+			c_write(c, hdr, 8);
+			hasher h (t.hash);
+			off_t off = (off_t)(idx * t.chunk_sz);
+			for (size_t rest = t.chunk_len(idx); rest != 0;) {
+				ssize_t rs = ::pread(t.fd, &buf[0], (rest < piece_sz) ? rest : piece_sz, off);
+				if (rs < 1)
+					throw socketxx::other_error("striped file send : failed to read file");
+				h.update(&buf[0], (size_t)rs);
+				c_write(c, &buf[0], (size_t)rs);
+				off += rs;
+				rest -= (size_t)rs;
+				t.progress((size_t)rs);
+			}
+			auto_bdata digest = h.final();
+			if (digest.len != 0)
+				c_write(c, digest.p, digest.len);
+		}
+	}
+
+		/// Receiving thread : write the chunks of the connection in the file, and journal them if their digest is right
+	void recv_chunks (transfer& t, size_t ci) {
+		conn& c = t.conns[ci];
+		std::vector<uint8_t> buf (piece_sz);
+		uint8_t digest[16];
+		size_t digest_len = hasher::digest_len(t.hash);
+		for (size_t k = ci; k < t.pending.size(); k += t.conns.size()) {
+			uint64_t idx = t.pending[k];
+			uint8_t hdr[8];
+			c_read(c, hdr, 8);
+			if (get_u64(hdr) != idx)
+				throw socketxx::error("striped file receive : unexpected chunk (protocol error)");
+			hasher h (t.hash);
+			off_t off = (off_t)(idx * t.chunk_sz);
+			for (size_t rest = t.chunk_len(idx); rest != 0;) {
+				size_t r = (c.s->*c.f.i)(&buf[0], (rest < piece_sz) ? rest : piece_sz);
+				h.update(&buf[0], r);
+				for (size_t w = 0; w < r;) {
+					ssize_t rs = ::pwrite(t.fd, &buf[w], r-w, off);
+					if (rs < 1)
+						throw socketxx::other_error("striped file receive : failed to write to file");
+					w += (size_t)rs;
+					off += rs;
+				}
+				rest -= r;
+				t.progress(r);
+			}
+			c_read(c, digest, digest_len);
+			auto_bdata r_digest = h.final();
+			if (digest_len != 0 and ::memcmp(digest, r_digest.p, digest_len) != 0) {
+				t.lock(); t.bad_chunks = true; t.unlock();
+				continue; // Not journaled : will be sent again on resume
+			}
+				// Journal the chunk, once its data is on disk. Adjacent chunks share a byte of the bitmap : it is written
+				//  under the lock, so that a stale byte never overwrites a newer one.
+#ifdef HAVE_FDATASYNC
+			::fdatasync(t.fd);
+#else
+			::fsync(t.fd);
+#endif
+			t.lock();
+			t.bitmap[idx/8] |= (uint8_t)(1 << (idx%8));
+			bool journaled = (::pwrite(t.journal, &t.bitmap[idx/8], 1, (off_t)(journal_header_sz + idx/8)) == 1);
+			t.unlock();
+			if (not journaled)
+				throw socketxx::other_error("striped file receive : failed to write journal");
+		}
+	}
+
+		/// Run the function on each connection, in a thread per connection. Errors are thrown once all are done.
+	struct worker {
+		transfer* t;
+		size_t ci;
+		void (*f) (transfer&, size_t);
+		std::exception_ptr err;
+#ifndef XIF_NO_THREADS
+		pthread_t thread;
+		bool started;
+		static void* _run (void* arg) { ((worker*)arg)->run(); return NULL; }
+#endif
+		void run () { try { f(*t, ci); } catch (...) { err = std::current_exception(); } }
+	};
+	void run_workers (transfer& t, void (*f) (transfer&, size_t)) {
+		std::vector<worker> workers (t.conns.size());
+		for (size_t i = 0; i < workers.size(); i++) {
+			workers[i].t = &t;
+			workers[i].ci = i;
+			workers[i].f = f;
+		}
+#ifndef XIF_NO_THREADS
+		for (size_t i = 1; i < workers.size(); i++)
+			workers[i].started = (::pthread_create(&workers[i].thread, NULL, &worker::_run, &workers[i]) == 0);
+		workers[0].run(); // First connection on this thread
+		for (size_t i = 1; i < workers.size(); i++) {
+			if (workers[i].started) ::pthread_join(workers[i].thread, NULL);
+			else workers[i].run(); // Thread creation failed
+		}
+#else
+		for (size_t i = 0; i < workers.size(); i++)
+			workers[i].run(); // Sequentially : chunks are written and read in the same order on each connection
+#endif
+		for (size_t i = 0; i < workers.size(); i++)
+			if (workers[i].err)
+				std::rethrow_exception(workers[i].err);
+	}
+
+		/// Sender side
+	void send (std::vector<conn>& conns, fd_t file_r, size_t sz, size_t chunk_sz, hash_t hash, _simple_socket::trsf_info_f info_f) {
+		if (chunk_sz == 0)
+			throw socketxx::error("striped file send : null chunk size");
+		if (hasher::digest_len(hash) > 16)
+			throw socketxx::error("striped file send : unsupported hash");
+		transfer t (conns);
+		t.fd = file_r;
+		t.sz = sz;
+		t.chunk_sz = chunk_sz;
+		t.hash = hash;
+		t.info_f = info_f;
+			// Offer : size, chunk size, hash
+		uint8_t hdr[17];
+		put_u64(hdr, sz);
+		put_u64(hdr+8, chunk_sz);
+		hdr[16] = (uint8_t)hash;
+		c_write(conns[0], hdr, 17);
+		if (sz == 0) return;
+			// Chunks already received
+		t.bitmap.resize(((sz + chunk_sz - 1) / chunk_sz + 7) / 8);
+		c_read(conns[0], t.bitmap.data(), t.bitmap.size());
+		t.make_pending();
+		run_workers(t, &send_chunks);
+			// Final acknowledgement
+		uint8_t ack;
+		c_read(conns[0], &ack, 1);
+		if (ack != 1)
+			throw socketxx::error("striped file send : some chunks failed verification, transfer can be resumed");
+	}
+
+		/// Receiver side
+	size_t recv (std::vector<conn>& conns, const char* path, _simple_socket::trsf_info_f info_f) {
+		transfer t (conns);
+		t.info_f = info_f;
+			// Offer
+		uint8_t hdr[17];
+		c_read(conns[0], hdr, 17);
+		t.sz = (size_t)get_u64(hdr);
+		t.chunk_sz = (size_t)get_u64(hdr+8);
+		t.hash = (hash_t)hdr[16];
+		if (t.chunk_sz == 0 or hasher::digest_len(t.hash) > 16)
+			throw socketxx::error("striped file receive : bad transfer parameters");
+			// File and journal. The journal is valid only for the same transfer parameters
+		std::string journal_path = std::string(path) + ".sxjournal";
+		struct fds {
+			fd_t file, journal;
+			fds () : file(SOCKETXX_INVALID_HANDLE), journal(SOCKETXX_INVALID_HANDLE) {}
+			~fds () { if (file != SOCKETXX_INVALID_HANDLE) ::close(file); if (journal != SOCKETXX_INVALID_HANDLE) ::close(journal); }
+		} f;
+		f.file = t.fd = ::open(path, O_CREAT|O_WRONLY|O_NOFOLLOW, 0600);
+		if (f.file == -1)
+			throw socketxx::other_error("striped file receive : failed to open file");
+		t.bitmap.resize(((t.sz + t.chunk_sz - 1) / t.chunk_sz + 7) / 8, 0);
+		uint8_t jhdr[journal_header_sz];
+		::memcpy(jhdr, journal_magic, sizeof(journal_magic));
+		put_u64(jhdr+8, t.sz);
+		put_u64(jhdr+16, t.chunk_sz);
+		jhdr[24] = (uint8_t)t.hash;
+		bool resumed = false;
+		f.journal = t.journal = ::open(journal_path.c_str(), O_CREAT|O_RDWR|O_NOFOLLOW, 0600);
+		if (f.journal == -1)
+			throw socketxx::other_error("striped file receive : failed to open journal");
+		uint8_t ohdr[journal_header_sz];
+		if (::pread(t.journal, ohdr, journal_header_sz, 0) == (ssize_t)journal_header_sz and ::memcmp(ohdr, jhdr, journal_header_sz) == 0
+		    and ::pread(t.journal, t.bitmap.data(), t.bitmap.size(), journal_header_sz) == (ssize_t)t.bitmap.size())
+			resumed = true;
+		if (not resumed) {
+			std::fill(t.bitmap.begin(), t.bitmap.end(), 0);
+			if (::ftruncate(t.journal, 0) == -1 or ::ftruncate(f.file, (off_t)t.sz) == -1
+			    or ::pwrite(t.journal, jhdr, journal_header_sz, 0) != (ssize_t)journal_header_sz
+			    or ::pwrite(t.journal, t.bitmap.data(), t.bitmap.size(), journal_header_sz) != (ssize_t)t.bitmap.size())
+				throw socketxx::other_error("striped file receive : failed to initialize file and journal");
+		}
+		if (t.sz != 0) {
+			c_write(conns[0], t.bitmap.data(), t.bitmap.size());
+			t.make_pending();
+			run_workers(t, &recv_chunks);
+		}
+			// Final acknowledgement
+		uint8_t ack = t.bad_chunks ? 0 : 1;
+		if (t.sz != 0)
+			c_write(conns[0], &ack, 1);
+		if (t.bad_chunks)
+			throw socketxx::error("striped file receive : some chunks failed verification, transfer can be resumed");
+		::unlink(journal_path.c_str());
+		return t.sz;
+	}
+
+}}}
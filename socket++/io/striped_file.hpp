@@ -0,0 +1,81 @@
+#ifndef SOCKET_XX_STRIPED_FILE_H
+#define SOCKET_XX_STRIPED_FILE_H
+
+	// BaseIO, simple_socket
+#include <socket++/base_io.hpp>
+#include <socket++/io/simple_socket.hpp>
+#include <socket++/io/checksum.hpp>
+
+	// General
+#include <vector>
+#include <string>
+
+namespace socketxx { namespace io {
+
+		// Private external functions
+	namespace _striped_file {
+
+		const size_t chunk_default = 8*1024*1024;
+
+			// A connection and its I/O functions
+		struct conn {
+			socketxx::base_fd* s;
+			base_fd::_io_fncts f;
+		};
+
+		void send (std::vector<conn>& conns, fd_t file_r, size_t sz, size_t chunk_sz, hash_t hash, _simple_socket::trsf_info_f info_f);
+		size_t recv (std::vector<conn>& conns, const char* path, _simple_socket::trsf_info_f info_f); // Open/create the file and its journal. Returns the file's size
+
+			// Access to the I/O functions of a simple_socket
+		template <typename io_base>
+		struct _fncts_of : public simple_socket<io_base> {
+			static base_fd::_io_fncts get (simple_socket<io_base>& s) { return (s.*&_fncts_of::_get_io_fncts)(); }
+		};
+		template <typename io_base>
+		std::vector<conn> make_conns (std::vector< simple_socket<io_base> >& socks) {
+			if (socks.empty())
+				throw socketxx::error("striped file : no connection");
+			std::vector<conn> conns;
+			for (size_t i = 0; i < socks.size(); i++)
+				conns.push_back(conn({ &socks[i], _fncts_of<io_base>::get(socks[i]) }));
+			return conns;
+		}
+
+	}
+
+	/***** Striped file transfer *****
+	 *
+	 *  Sends a file over several connections in parallel (one thread per connection) : the file is cut in chunks
+	 *   dealt round-robin to the connections, and written at their offset by the receiver.
+	 *  Each chunk is verified with its own checksum (chosen by the sender, CRC32C by default).
+	 *  The receiver keeps a journal of verified chunks next to the file (`path`.sxjournal) : if the transfer fails
+	 *   (broken connection, bad checksum), calling again both functions with new connections resumes it,
+	 *   only the missing chunks being sent. The journal is deleted when the transfer is complete.
+	 *  Connections must be in the same order on both side. The first one is also used for control messages.
+	 *  On error, the first exception is thrown once all connections are done. The connections should then be closed.
+	 *  Progress callbacks are called from the connection threads, but never concurrently.
+	 */
+
+	template <typename io_base>
+	void o_file_striped (std::vector< simple_socket<io_base> >& socks, const char* path, size_t chunk_sz = _striped_file::chunk_default, hash_t hash = HASH_CRC32C, _simple_socket::trsf_info_f info_f = NULL) {
+		std::vector<_striped_file::conn> conns = _striped_file::make_conns(socks);
+		fd_t filefd = SOCKETXX_INVALID_HANDLE;
+		size_t sz = _simple_socket::open_file_read(filefd, path);
+		try {
+			_striped_file::send(conns, filefd, sz, chunk_sz, hash, info_f);
+		} catch (...) {
+			::close(filefd); throw;
+		}
+		::close(filefd);
+	}
+
+		// Returns the file's size
+	template <typename io_base>
+	size_t i_file_striped (std::vector< simple_socket<io_base> >& socks, const char* path, _simple_socket::trsf_info_f info_f = NULL) {
+		std::vector<_striped_file::conn> conns = _striped_file::make_conns(socks);
+		return _striped_file::recv(conns, path, info_f);
+	}
+
+}}
+
+#endif
@@ -45,12 +45,12 @@ namespace socketxx { namespace io {
 			// Default constructor
 		text_socket () : line_sep("\r\n"), buffer(std::string()) {}
 			// Private relay constructor
-		text_socket (bool autoclose_handle, socket_t handle) : io_base(autoclose_handle, handle) {}
+		text_socket (bool autoclose_handle, socket_t handle) : io_base(autoclose_handle, handle), line_sep("\r\n") {}
 		
 	public:
 		
 			// Construct from an io_base object
-		text_socket (const io_base& iob) : io_base(iob) {}
+		text_socket (const io_base& iob) : io_base(iob), line_sep("\r\n") {}
 		
 			// Set the line separator
 		void set_line_sep (const char* sep)   { line_sep = sep; } // Must contain at least one char, max 256 chars
@@ -24,13 +24,16 @@ namespace socketxx { namespace io {
 			FD_ZERO(&select_set);
 			FD_SET(fd1, &select_set);
 			FD_SET(fd2, &select_set);
-			timeval tm = timeout;
-			r = ::select(maxfd, &select_set, NULL, NULL, (timeout==TIMEOUT_INF)?(timeval*)NULL:&tm);
+			bool buffered1 = (s1.i_buffered() != 0), buffered2 = (s2.i_buffered() != 0); // Already buffered data don't wake up select()
+			timeval tm = (buffered1 or buffered2) ? TIMEOUT_NOBLOCK : timeout;
+			r = ::select(maxfd, &select_set, NULL, NULL, (tm==TIMEOUT_INF)?(timeval*)NULL:&tm);
 			if (r == -1) {
 				if (errno == EINTR) continue;
 				throw socketxx::other_error("select() error while tunneling");
 			}
-			if (r == 0) throw socketxx::timeout_event();
+			if (r == 0 and not (buffered1 or buffered2)) throw socketxx::timeout_event();
+			if (buffered1) FD_SET(fd1, &select_set);
+			if (buffered2) FD_SET(fd2, &select_set);
 			try {
 				if (FD_ISSET(fd1, &select_set)) {
 					size_t len = (s1.*i1)(buf.b, buf.sz);
@@ -14,6 +14,12 @@ namespace socketxx { namespace io {
 		                        socketxx::base_fd& s2, base_fd::_io_fncts::i_fnct i2, base_fd::_io_fncts::o_fnct o2, 
 		                        void(*f)(bool,void**, size_t*, size_t), timeval timeout);
 		
+			// Access to the I/O functions of any BaseIO
+		template <typename io_base>
+		struct _fncts_of : public io_base {
+			static base_fd::_io_fncts get (io_base& s) { return (s.*&_fncts_of::_get_io_fncts)(); }
+		};
+		
 	}
 	
 	template <typename io_base, typename io_base_other>
@@ -33,7 +39,7 @@ namespace socketxx { namespace io {
 		
 			// Start tunneling with another socket. Blocks until disconnection of one side
 		void start_tunneling (socketxx::base_fd& other) {
-			socketxx::base_fd::_io_fncts other_io_fncts = (((io_base_other*)&other)->*&tunnel::_get_io_fncts)();
+			socketxx::base_fd::_io_fncts other_io_fncts = _tunnel::_fncts_of<io_base_other>::get(*(io_base_other*)&other);
 			_tunnel::do_copy_tunneling(*this, this->_get_io_fncts().i, this->_get_io_fncts().o,
 			                           other, other_io_fncts.i, other_io_fncts.o,
 			                           NULL, this->get_read_timeout());
@@ -41,7 +47,7 @@ namespace socketxx { namespace io {
 			// Tunneling with intercepting callback. If returned len if bigger than buf_sz, the internal buffer is replaced by yours (allocated by new char[len])
 		typedef void (*intercept_fnct_t) (bool this_to_other, void** buf, size_t* len, size_t buf_sz);
 		void start_tunneling (socketxx::base_fd& other, intercept_fnct_t callback) {
-			socketxx::base_fd::_io_fncts other_io_fncts = (((io_base_other*)&other)->*&tunnel::_get_io_fncts)();
+			socketxx::base_fd::_io_fncts other_io_fncts = _tunnel::_fncts_of<io_base_other>::get(*(io_base_other*)&other);
 			_tunnel::do_copy_tunneling(*this, this->_get_io_fncts().i, this->_get_io_fncts().o,
 			                           other, other_io_fncts.i, other_io_fncts.o,
 			                           callback, this->get_read_timeout());
@@ -0,0 +1,75 @@
+#include <socket++/io_stats.hpp>
+
+namespace socketxx {
+
+	/************* I/O statistics Implementation *************/
+
+	io_stats_snapshot::io_stats_snapshot () : bytes_in(0), bytes_out(0), read_calls(0), write_calls(0), short_reads(0), read_errors(0), write_errors(0), blocked_ns(0) {
+		for (unsigned i = 0; i < hist_buckets; i++)
+			read_lat[i] = write_lat[i] = 0;
+	}
+
+	io_stats_snapshot& io_stats_snapshot::operator+= (const io_stats_snapshot& o) {
+		bytes_in += o.bytes_in; bytes_out += o.bytes_out;
+		read_calls += o.read_calls; write_calls += o.write_calls;
+		short_reads += o.short_reads;
+		read_errors += o.read_errors; write_errors += o.write_errors;
+		blocked_ns += o.blocked_ns;
+		for (unsigned i = 0; i < hist_buckets; i++) {
+			read_lat[i] += o.read_lat[i];
+			write_lat[i] += o.write_lat[i];
+		}
+		return *this;
+	}
+
+	uint64_t io_stats_snapshot::percentile (const uint64_t* hist, double p) {
+		uint64_t total = 0;
+		for (unsigned i = 0; i < hist_buckets; i++)
+			total += hist[i];
+		if (total == 0)
+			return 0;
+		uint64_t rank = (uint64_t)(p * (double)total + 0.5);
+		if (rank == 0) rank = 1;
+		uint64_t n = 0;
+		for (unsigned i = 0; i < hist_buckets-1; i++) {
+			n += hist[i];
+			if (n >= rank)
+				return (uint64_t)1 << (i+1);
+		}
+		return UINT64_MAX;
+	}
+
+	io_stats::io_stats () {
+		this->reset();
+	}
+
+	void io_stats::reset () {
+		bytes_in = 0; bytes_out = 0;
+		read_calls = 0; write_calls = 0;
+		short_reads = 0;
+		read_errors = 0; write_errors = 0;
+		blocked_ns = 0;
+		for (unsigned i = 0; i < io_stats_snapshot::hist_buckets; i++) {
+			read_lat[i] = 0;
+			write_lat[i] = 0;
+		}
+	}
+
+	io_stats_snapshot io_stats::snapshot () const {
+		io_stats_snapshot s;
+		s.bytes_in = bytes_in.load(std::memory_order_relaxed);
+		s.bytes_out = bytes_out.load(std::memory_order_relaxed);
+		s.read_calls = read_calls.load(std::memory_order_relaxed);
+		s.write_calls = write_calls.load(std::memory_order_relaxed);
+		s.short_reads = short_reads.load(std::memory_order_relaxed);
+		s.read_errors = read_errors.load(std::memory_order_relaxed);
+		s.write_errors = write_errors.load(std::memory_order_relaxed);
+		s.blocked_ns = blocked_ns.load(std::memory_order_relaxed);
+		for (unsigned i = 0; i < io_stats_snapshot::hist_buckets; i++) {
+			s.read_lat[i] = read_lat[i].load(std::memory_order_relaxed);
+			s.write_lat[i] = write_lat[i].load(std::memory_order_relaxed);
+		}
+		return s;
+	}
+
+}
@@ -0,0 +1,88 @@
+#ifndef SOCKET_XX_IO_STATS_H
+#define SOCKET_XX_IO_STATS_H
+
+	// Defs
+#include <socket++/defs.hpp>
+
+	// General headers
+#include <atomic>
+#include <stdint.h>
+#include <time.h>
+
+namespace socketxx {
+
+		/// Snapshot of I/O statistics, with plain values. Can be summed.
+	struct io_stats_snapshot {
+			// Latency histograms : bucket `i` counts calls lasting [2^i, 2^(i+1)) ns, the last bucket is unbounded (> 2s)
+		static const unsigned hist_buckets = 32;
+
+		uint64_t bytes_in, bytes_out;       // Data returned by reads and given to writes (plaintext for SSL sockets)
+		uint64_t read_calls, write_calls;   // Underlying calls : read(), recv(), send(), SSL_read(), splice()...
+		uint64_t short_reads;               // Fixed-size reads needing more than one call
+		uint64_t read_errors, write_errors; // Failed calls, including closed connections and timeouts
+		uint64_t blocked_ns;                // Total time spent in read and write calls, waits included
+		uint64_t read_lat[hist_buckets], write_lat[hist_buckets];
+
+		io_stats_snapshot ();
+		io_stats_snapshot& operator+= (const io_stats_snapshot& o);
+
+			// Latency percentile (`p` in [0,1]) estimated from the histograms, as the upper bound of the bucket, in ns. 0 if no call.
+		uint64_t read_lat_percentile (double p) const  { return percentile(read_lat, p); }
+		uint64_t write_lat_percentile (double p) const { return percentile(write_lat, p); }
+	private:
+		static uint64_t percentile (const uint64_t* hist, double p);
+	};
+
+		/// Live I/O counters of a BaseIO, shared by its copies.
+	/*
+	 *  Counters are relaxed atomics : I/O from several threads is counted, but a snapshot taken
+	 *   during I/O can be slightly inconsistent (eg. bytes counted before the call).
+	 */
+	class io_stats {
+	private:
+		std::atomic<uint64_t> bytes_in, bytes_out;
+		std::atomic<uint64_t> read_calls, write_calls;
+		std::atomic<uint64_t> short_reads;
+		std::atomic<uint64_t> read_errors, write_errors;
+		std::atomic<uint64_t> blocked_ns;
+		std::atomic<uint64_t> read_lat[io_stats_snapshot::hist_buckets], write_lat[io_stats_snapshot::hist_buckets];
+		static unsigned bucket (uint64_t ns) { unsigned i = 63 - (unsigned)__builtin_clzll(ns|1); return (i < io_stats_snapshot::hist_buckets) ? i : io_stats_snapshot::hist_buckets-1; }
+		static void add (std::atomic<uint64_t>& c, uint64_t n) { c.fetch_add(n, std::memory_order_relaxed); }
+	public:
+		io_stats ();
+		io_stats (const io_stats&) = delete;
+
+			// Count a call. `r` is the call's return value : partial writes are not errors
+		void count_read (ssize_t r, uint64_t ns)              { add(read_calls, 1); add(blocked_ns, ns); add(read_lat[bucket(ns)], 1); if (r > 0) add(bytes_in, (uint64_t)r); else add(read_errors, 1); }
+		void count_write (ssize_t r, uint64_t ns)             { add(write_calls, 1); add(blocked_ns, ns); add(write_lat[bucket(ns)], 1); if (r > 0) add(bytes_out, (uint64_t)r); else add(write_errors, 1); }
+		void count_short_read ()                              { add(short_reads, 1); }
+
+		io_stats_snapshot snapshot () const;
+		void reset ();
+	};
+
+		// Private tools
+	namespace _io_stats {
+
+		inline uint64_t now_ns () {
+			timespec ts;
+			::clock_gettime(CLOCK_MONOTONIC, &ts);
+			return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+		}
+
+			// Times one call if stats are enabled (`st` not NULL); otherwise costs only a test
+		class timer {
+			io_stats* const st;
+			uint64_t beg;
+		public:
+			timer (io_stats* st) : st(st), beg((st != NULL) ? now_ns() : 0) {}
+			void read (ssize_t r)              { if (st != NULL) { uint64_t t = now_ns(); st->count_read(r, t-beg); beg = t; } } // Next call is timed from now
+			void write (ssize_t r)             { if (st != NULL) { uint64_t t = now_ns(); st->count_write(r, t-beg); beg = t; } }
+			void short_read ()                 { if (st != NULL) st->count_short_read(); }
+		};
+
+	}
+
+}
+
+#endif
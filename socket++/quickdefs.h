@@ -10,5 +10,15 @@ namespace socketxx {
 			using simple_socket_server = end::socket_server<io::simple_socket<socket_base>,cli_data_t>;
 		#define SOCKETXX_SIMPLE_SOCKET_SERVER
 	#endif
+	#if defined(SOCKET_XX_BASE_STOPPABLE_H) && defined(SOCKET_XX_SIMPLE_SOCKET_H) && !defined(SOCKETXX_STOPPABLE_SIMPLE_SOCKET)
+		template <typename socket_base> 
+			using stoppable_simple_socket = io::simple_socket<base_stoppable<socket_base>>;
+		#define SOCKETXX_STOPPABLE_SIMPLE_SOCKET
+	#endif
+	#if defined(SOCKET_XX_BASE_STOPPABLE_H) && defined(SOCKET_XX_TEXT_BUFFERED_BASE_H) && !defined(SOCKETXX_STOPPABLE_TEXT_SOCKET)
+		template <typename socket_base> 
+			using stoppable_text_socket = io::text_socket<base_stoppable<socket_base>>;
+		#define SOCKETXX_STOPPABLE_TEXT_SOCKET
+	#endif
 	
 }
\ No newline at end of file